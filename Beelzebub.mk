@@ -140,6 +140,7 @@ ifneq (,$(findstring test-all,$(MAKECMDGOALS)))
 	PRECOMPILER_FLAGS	+= __BEELZEBUB__TEST_RW_SPINLOCK 
 	PRECOMPILER_FLAGS	+= __BEELZEBUB__TEST_VAS 
 	PRECOMPILER_FLAGS	+= __BEELZEBUB__TEST_INTERRUPT_LATENCY 
+	PRECOMPILER_FLAGS	+= __BEELZEBUB__TEST_SCHED 
 
 	SETTINGS			+= test-all
 else
@@ -238,6 +239,12 @@ else
 
 		SETTINGS			+= test-interrupt-latency 
 	endif
+
+	ifneq (,$(findstring test-sched,$(MAKECMDGOALS)))
+		PRECOMPILER_FLAGS	+= __BEELZEBUB__TEST_SCHED 
+
+		SETTINGS			+= test-sched 
+	endif
 endif
 
 ####################################### PRECOMPILER FLAGS ##########
@@ -54,11 +54,18 @@ namespace Beelzebub { namespace Execution
         /*  Constructors  */
 
         inline ProcessArchitecturalBase()
+            : Pcid(0)
         {
 
         }
 
         ProcessArchitecturalBase(ProcessArchitecturalBase const &) = delete;
         ProcessArchitecturalBase & operator =(ProcessArchitecturalBase const &) = delete;
+
+        /*  Fields  */
+
+        Synchronization::Atomic<uint64_t> Pcid;
+        //  The PCID in the lower 12 bits, and the generation it belongs to in
+        //  the rest. Zero means none was assigned yet.
     };
 }}
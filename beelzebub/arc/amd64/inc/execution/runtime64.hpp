@@ -52,6 +52,7 @@ namespace Beelzebub { namespace Execution
         /*  Statics  */
 
         static Elf Template;
+        static SharedData * Shared;
 
         /*  Constructors  */
 
@@ -67,5 +68,7 @@ namespace Beelzebub { namespace Execution
         static Handle Initialize();
 
         static Handle Deploy(uintptr_t base, StartupData * & data);
+
+        static void UpdateSharedData();
     };
 }}
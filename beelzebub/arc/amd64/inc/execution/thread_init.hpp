@@ -43,7 +43,11 @@
 
 namespace Beelzebub { namespace Execution
 {
-    void InitializeThreadState(Thread * const thread);
+    /**
+     *  Prepares a thread to start at its entry point. Fails if the thread
+     *  needs an extended state which cannot be allocated.
+     */
+    Handle InitializeThreadState(Thread * const thread);
 
     __startup Handle InitializeBootstrapThread(Thread * const bst, Process * const bsp);
 }}
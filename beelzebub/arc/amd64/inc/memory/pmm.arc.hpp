@@ -102,7 +102,8 @@ namespace Beelzebub { namespace Memory
 
         __forceinline uint32_t AdjustReferenceCount(int32_t diff)
         {
-            return this->ReferenceCount += diff;
+            return __atomic_add_fetch(&(this->ReferenceCount), diff, __ATOMIC_SEQ_CST);
+            //  Frames held by per-core caches are adjusted without locks.
         }
 
         /*  Status  */
@@ -372,11 +373,16 @@ namespace Beelzebub { namespace Memory
         /*  Frame manipulation  */
 
         __hot paddr_t AllocateFrame(FrameSize size, uint32_t refCnt);
+        __hot size_t AllocateFrames(FrameSize size, paddr_t * frames
+            , FrameDescriptor * * descs, size_t count);
+        __hot paddr_t AllocateContiguous(size_t count, FrameSize size, uint32_t refCnt);
+        __hot void FreeFrames(FrameSize size, paddr_t const * frames, size_t count);
 
         __hot Handle Mingle(paddr_t addr, uint32_t & newCnt, int32_t diff, bool ignoreRefCnt);
         __cold Handle ReserveRange(paddr_t start, psize_t size, bool includeBusy);
 
         Handle GetFrameInfo(paddr_t addr, FrameSize & size, uint32_t & refCnt);
+        __hot FrameDescriptor * PeekUsedFrame(paddr_t addr, FrameSize & size);
 
         inline bool ContainsRange(paddr_t start, psize_t size) const
         {
@@ -384,6 +390,17 @@ namespace Beelzebub { namespace Memory
                 && ((start + size) <= this->AllocationEnd);
         }
 
+        /*  Split Frames  */
+
+        __hot paddr_t PopSmallFrame(uint32_t refCnt);
+        __hot bool PushSmallFrame(uint32_t lIndex, uint16_t sIndex);
+
+        /*  Contiguous Frames  */
+
+        __hot paddr_t AllocateSmallRun(size_t count, uint32_t refCnt);
+        __hot paddr_t ClaimSmallRun(uint32_t lIndex, uint16_t first, size_t count, uint32_t refCnt);
+        __hot paddr_t AllocateLargeRun(size_t count, uint32_t refCnt);
+
         /*  Fields  */
 
         LargeFrameDescriptor * Map;
@@ -398,6 +415,10 @@ namespace Beelzebub { namespace Memory
         FrameAllocationSpace * Next;
         FrameAllocationSpace * Previous;
 
+        uint32_t Node;
+        //  Index of the NUMA node which holds this space.
+        FrameAllocationSpace * NodeNext;
+
         /*  Debug  */
 
     #ifdef __BEELZEBUB__CONF_DEBUG
@@ -412,6 +433,9 @@ namespace Beelzebub { namespace Memory
     class FrameAllocator
     {
     public:
+        /*  Constants  */
+
+        static constexpr size_t const MaxNodes = 16;
 
         /*  Constructors  */
 
@@ -419,6 +443,7 @@ namespace Beelzebub { namespace Memory
             : ChainLock()
             , FirstSpace(nullptr)
             , LastSpace(nullptr)
+            , NodeSpaces()
         {
 
         }
@@ -427,6 +452,7 @@ namespace Beelzebub { namespace Memory
             : ChainLock()
             , FirstSpace(first)
             , LastSpace(first)
+            , NodeSpaces()
         {
             
         }
@@ -436,12 +462,19 @@ namespace Beelzebub { namespace Memory
 
         /*  Page Manipulation  */
 
-        __hot paddr_t AllocateFrame(FrameSize size, AddressMagnitude magn, uint32_t refCnt);
+        __hot paddr_t AllocateFrame(FrameSize size, AddressMagnitude magn, uint32_t refCnt
+            , uint32_t node = 0);
+        __hot size_t AllocateFrames(FrameSize size, paddr_t * frames
+            , FrameDescriptor * * descs, size_t count, uint32_t node = 0);
+        __hot paddr_t AllocateContiguous(size_t count, FrameSize size, AddressMagnitude magn
+            , uint32_t refCnt, uint32_t node = 0);
+        __hot void FreeFrames(FrameSize size, paddr_t const * frames, size_t count);
 
         __hot Handle Mingle(paddr_t addr, uint32_t & newCnt, int32_t diff, bool ignoreRefCnt);
         __cold Handle ReserveRange(paddr_t start, psize_t size, bool includeBusy);
 
         Handle GetFrameInfo(paddr_t addr, FrameSize & size, uint32_t & refCnt);
+        __hot FrameDescriptor * PeekUsedFrame(paddr_t addr, FrameSize & size, uint32_t & node);
 
         bool ContainsRange(paddr_t start, psize_t size);
         __hot FrameAllocationSpace * GetSpace(paddr_t paddr);
@@ -457,6 +490,9 @@ namespace Beelzebub { namespace Memory
         FrameAllocationSpace * FirstSpace;
         FrameAllocationSpace * LastSpace;
 
+        FrameAllocationSpace * NodeSpaces[MaxNodes];
+        //  Spaces chained by NUMA node, once the topology is known.
+
         __cold void PreppendAllocationSpace(FrameAllocationSpace * space);
         __cold void AppendAllocationSpace(FrameAllocationSpace * space);
 
@@ -476,10 +512,20 @@ namespace Beelzebub { namespace Memory
         static FrameAllocationSpace * AllocationSpace;
         static FrameAllocator * MainAllocator;
 
+        static size_t NodeCount;
+        static uint32_t NodeDomains[FrameAllocator::MaxNodes];
+        static uint8_t NodeOrder[FrameAllocator::MaxNodes][FrameAllocator::MaxNodes];
+        //  For every node, all nodes from the nearest to the farthest.
+
         /*  Initialization  */
 
         static __cold Handle CreateAllocationSpace(paddr_t start, paddr_t end);
 
+        /*  NUMA  */
+
+        static __cold Handle ApplyAffinity();
+        static __cold uint32_t GetApicNode(uint32_t apicId);
+
         /*  Relocation  */
 
         static __cold void Remap(FrameAllocator * & alloc, vaddr_t const oldVaddr, vaddr_t const newVaddr);
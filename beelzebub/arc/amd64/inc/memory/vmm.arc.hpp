@@ -69,6 +69,7 @@ namespace Beelzebub { namespace Memory
         static bool Page1GB, NX, PCID;
 
         static __thread paddr_t LastAlienPml4;
+        static __thread uint64_t LocalPcidGeneration;
 
         //  End of the lower half address range.
         static constexpr vaddr_t const LowerHalfEnd              = 0x0000800000000000ULL;
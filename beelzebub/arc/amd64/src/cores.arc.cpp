@@ -39,9 +39,12 @@
 
 #include "cores.hpp"
 #include "memory/vmm.hpp"
+#include "memory/vmm.arc.hpp"
+#include "memory/pmm.arc.hpp"
 #include "system/cpu.hpp"
 #include "kernel.image.hpp"
 #include "kernel.hpp"
+#include <entry.h>
 #include <beel/sync/atomic.hpp>
 #include <math.h>
 #include <string.h>
@@ -150,10 +153,27 @@ void Cores::Register()
 
     Msrs::Write(Msr::IA32_GS_BASE, (uint64_t)(uintptr_t)data);
 
+    if (BootstrapCpuid.CheckFeature(CpuFeature::RDTSP))
+        Msrs::Write(Msr::IA32_TSC_AUX, (uint64_t)index);
+    //  Lets userland find out which core it is running on, through `rdtscp`.
+
     //  Now, the rest of the structure...
 
     data->DomainDescriptor = &Domain0;
 
+    uint32_t a, b, c, d;
+    CpuId::Execute(1U, 0U, a, b, c, d);
+    uint32_t apicId = b >> 24;
+
+    if (BootstrapCpuid.MaxStandardValue >= 0xB)
+    {
+        CpuId::Execute(0xBU, 0U, a, b, c, d);
+        apicId = d;
+    }
+    //  The x2APIC ID is complete; the initial APIC ID only has 8 bits.
+
+    data->NumaNode = PmmArc::GetApicNode(apicId);
+
     withLock (data->DomainDescriptor->GdtLock)
     {
         //  This will eventually set the size to the highest value.
@@ -201,6 +221,13 @@ void Cores::Register()
         thread_id = (unsigned int)index;
     #endif
     }
+
+    //  Lastly, tagged TLB entries.
+
+    if (VmmArc::PCID)
+        Cpu::SetCr4(Cpu::GetCr4().SetPcide(true));
+    //  CR3 still holds PCID 0 here, as required. Address space switches on
+    //  this core will use PCIDs from now on.
 }
 
 #ifdef __BEELZEBUB__CONF_DEBUG
@@ -340,6 +340,16 @@ Handle InitializeVirtualMemory()
     VmmArc::Page1GB = BootstrapCpuid.CheckFeature(CpuFeature::Page1GB);
     VmmArc::NX      = BootstrapCpuid.CheckFeature(CpuFeature::NX     );
 
+    if (BootstrapCpuid.CheckFeature(CpuFeature::PCID) && BootstrapCpuid.MaxStandardValue >= 7)
+    {
+        uint32_t a, b, c, d;
+        CpuId::Execute(7U, 0U, a, b, c, d);
+
+        VmmArc::PCID = (b & (1U << 10)) != 0;
+        //  PCIDs are only used along with INVPCID, which is needed to
+        //  invalidate the translations of address spaces that aren't active.
+    }
+
     Vmm::Bootstrap(&BootstrapProcess);
     ++BootstrapProcess.ActiveCoreCount;
 
@@ -42,7 +42,10 @@
 #include <execution/elf_default_mapper.hpp>
 #include <memory/vmm.hpp>
 #include <system/cpu.hpp>
+#include <system/timers/tsc.hpp>
+#include <cores.hpp>
 #include <kernel.hpp>
+#include <entry.h>
 
 #include <string.h>
 #include <debug.hpp>
@@ -50,6 +53,9 @@
 using namespace Beelzebub;
 using namespace Beelzebub::Execution;
 using namespace Beelzebub::Memory;
+using namespace Beelzebub::Synchronization;
+using namespace Beelzebub::System;
+using namespace Beelzebub::System::Timers;
 
 static bool HeaderValidator(ElfHeader1 const * header, void * data)
 {
@@ -58,6 +64,9 @@ static bool HeaderValidator(ElfHeader1 const * header, void * data)
     return header->Identification.Class == ElfClass::Elf64;
 }
 
+static paddr_t SharedDataFrame = nullpaddr;
+static SmpLock SharedDataLock {};
+
 /**********************
     Runtime64 class
 **********************/
@@ -65,6 +74,7 @@ static bool HeaderValidator(ElfHeader1 const * header, void * data)
 /*  Statics  */
 
 Elf Runtime64::Template;
+SharedData * Runtime64::Shared = nullptr;
 
 /*  Methods  */
 
@@ -133,6 +143,32 @@ Handle Runtime64::Initialize()
         FAIL();
     }
 
+    //  Then, the page of data shared with every process.
+
+    vaddr_t sharedVaddr = nullvaddr;
+
+    Handle res = Vmm::AllocatePages(&BootstrapProcess
+        , PageSize
+        , MemoryAllocationOptions::Commit | MemoryAllocationOptions::VirtualKernelHeap
+        , MemoryFlags::Global | MemoryFlags::Writable
+        , MemoryContent::Runtime
+        , sharedVaddr);
+
+    ASSERTX(res.IsOkayResult()
+        , "Failed to allocate the shared data page.")
+        (res)XEND;
+
+    res = Vmm::Translate(&BootstrapProcess, sharedVaddr, SharedDataFrame);
+
+    ASSERTX(res.IsOkayResult() && SharedDataFrame != nullpaddr
+        , "Failed to translate the shared data page.")
+        (sharedVaddr)(res)XEND;
+
+    Shared = reinterpret_cast<SharedData *>(sharedVaddr);
+    memset(Shared, 0, PageSize);
+
+    UpdateSharedData();
+
     return HandleResult::Okay;
 }
 
@@ -167,6 +203,39 @@ Handle Runtime64::Deploy(uintptr_t base, StartupData * & data)
             return HandleResult::ImageLoadingFailure;
     }
 
+    //  Then map the shared data page right below the runtime, read-only.
+
+    vaddr_t sharedVaddr = base - PageSize;
+
+    if likely(Shared != nullptr)
+    {
+        Process * proc = Cpu::GetProcess();
+
+        Handle res = Vmm::AllocatePages(proc
+            , PageSize
+            , MemoryAllocationOptions::Used | MemoryAllocationOptions::VirtualUser
+            | MemoryAllocationOptions::Permanent
+            , MemoryFlags::Userland
+            , MemoryContent::Runtime
+            , sharedVaddr);
+
+        assert_or(res.IsOkayResult()
+            , "Failed to reserve the shared data page at %Xp: %H."
+            , sharedVaddr, res)
+            return res;
+
+        res = Vmm::MapPage(proc, sharedVaddr, SharedDataFrame, MemoryFlags::Userland
+            , MemoryMapOptions::NoReferenceCounting);
+        //  The frame belongs to the kernel, which never releases it.
+
+        assert_or(res.IsOkayResult()
+            , "Failed to map the shared data page at %Xp: %H."
+            , sharedVaddr, res)
+            return res;
+    }
+    else
+        sharedVaddr = nullvaddr;
+
     //  Then find a "Self" symbol.
 
     Elf::Symbol stdat_s = copy.GetSymbol(STARTUP_DATA_SYMBOL);
@@ -189,7 +258,35 @@ Handle Runtime64::Deploy(uintptr_t base, StartupData * & data)
     stdat->RuntimeImage = copy;
     //  Aye, copy the ELF class into the userland.
 
+    stdat->Shared = reinterpret_cast<SharedData const *>(sharedVaddr);
+
     data = stdat;
 
     return HandleResult::Okay;
 }
+
+void Runtime64::UpdateSharedData()
+{
+    SharedData * const sd = Shared;
+
+    if unlikely(sd == nullptr)
+        return;
+
+    withLock (SharedDataLock)
+    {
+        sd->Sequence = sd->Sequence + 1;
+        COMPILER_MEMORY_BARRIER();
+        //  Readers will retry until the sequence is even again. x86 does not
+        //  reorder stores, so only the compiler needs restraining.
+
+        sd->TscShift = Tsc::Shift;
+        sd->TscOffset = Tsc::Offset;
+        sd->TscMultiplier = Tsc::Multiplier;
+        sd->TscReliable = Tsc::IsReliable();
+        sd->CoreIndexInTscAux = BootstrapCpuid.CheckFeature(CpuFeature::RDTSP);
+        sd->CoreCount = (uint32_t)Cores::GetCount();
+
+        COMPILER_MEMORY_BARRIER();
+        sd->Sequence = sd->Sequence + 1;
+    }
+}
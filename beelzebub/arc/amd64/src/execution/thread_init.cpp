@@ -38,7 +38,9 @@
 */
 
 #include <execution/thread_init.hpp>
+#include <execution/extended_states.hpp>
 #include <system/cpu.hpp>
+#include <system/fpu.hpp>
 #include <math.h>
 #include <debug.hpp>
 #include <_print/isr.hpp>
@@ -48,8 +50,19 @@ using namespace Beelzebub::Execution;
 using namespace Beelzebub::Memory;
 using namespace Beelzebub::System;
 
-void Beelzebub::Execution::InitializeThreadState(Thread * const thread)
+Handle Beelzebub::Execution::InitializeThreadState(Thread * const thread)
 {
+    if (Fpu::Eager && thread->ExtendedState == nullptr)
+    {
+        Handle res = ExtendedStates::AllocateNew(thread->ExtendedState);
+
+        if (!res.IsOkayResult())
+            return res;
+    }
+    //  In eager mode, every thread carries an extended state, which is switched
+    //  along with it. Switches happen with interrupts disabled, so they cannot
+    //  allocate it themselves.
+
     thread->KernelStackTop &= ~((uintptr_t)0xF);
     thread->KernelStackBottom = (thread->KernelStackBottom + 0xF) & ~((uintptr_t)0xF);
     //  Makin' sure the stack is aligned on a 16-byte boundary.
@@ -89,6 +102,8 @@ void Beelzebub::Execution::InitializeThreadState(Thread * const thread)
     //     msg("Initialized thread state for %Xp:%n", thread);
     //     PrintToDebugTerminal(&(thread->State));
     // }
+
+    return HandleResult::Okay;
 }
 
 Handle Beelzebub::Execution::InitializeBootstrapThread(Thread * const bst, Process * const bsp)
@@ -102,7 +117,5 @@ Handle Beelzebub::Execution::InitializeBootstrapThread(Thread * const bst, Proce
     bst->KernelStackBottom = 0xFFFFFFFFFFFFC000U;//RoundDown((uintptr_t)&dummy, PageSize);
     bst->KernelStackTop = 0xFFFFFFFFFFFFF000U;//RoundUp((uintptr_t)&dummy, PageSize);
 
-    bst->Next = bst->Previous = bst;
-
     return HandleResult::Okay;
 }
@@ -66,6 +66,8 @@ Handle Thread::SwitchTo(Thread * const other, ThreadState * const dest)
 
     InterruptGuard<> intGuard;
 
+    //  In eager mode, every thread carries an extended state from its creation.
+
     //msg("A");
 
     if (thisProc != otherProc)
@@ -88,6 +90,8 @@ Handle Thread::SwitchTo(Thread * const other, ThreadState * const dest)
 
     auto cpuData = Cpu::GetData();
 
+    this->LastCore = cpuData->Index;
+
     cpuData->ActiveThread = other;
     cpuData->ActiveProcess = otherProc;
     cpuData->EmbeddedTss.Rsp[0] = other->KernelStackTop;
@@ -97,15 +101,23 @@ Handle Thread::SwitchTo(Thread * const other, ThreadState * const dest)
 
     *dest = other->State;
 
-    if (other->ExtendedState != nullptr)
+    if (Fpu::Eager)
+    {
+        Fpu::LoadState(other->ExtendedState);
+        //  No #NM trap, no CR0.TS toggling. XSAVEOPT/XSAVEC skip the components
+        //  which are unused, so this is cheap for threads which don't touch
+        //  SIMD registers.
+    }
+    else if (other->ExtendedState != nullptr)
     {
         if (this->ExtendedState == nullptr)
             CpuInstructions::Clts();
         //  Need this now.
 
-        if (cpuData->LastExtendedStateThread != other)
+        if (cpuData->LastExtendedStateThread != other || other->LastCore != cpuData->Index)
         {
-            //  So, the last thread whose extended state was used isn't this one.
+            //  So, the last thread whose extended state was used isn't this one,
+            //  or it has run on another core since.
 
             Fpu::LoadState(other->ExtendedState);
             //  Load new thread's extended state now. Don't waste cycles with yet
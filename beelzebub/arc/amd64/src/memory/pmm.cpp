@@ -40,8 +40,10 @@
 #include <memory/pmm.hpp>
 #include <memory/pmm.arc.hpp>
 #include <system/cpu.hpp>
+#include <system/acpi.hpp>
 #include <kernel.hpp>
 
+#include <beel/interrupt.state.hpp>
 #include <math.h>
 #include <debug.hpp>
 
@@ -92,26 +94,273 @@ paddr_t PmmArc::TempSpaceLimit = nullpaddr;
 FrameAllocationSpace * PmmArc::AllocationSpace = nullptr;
 FrameAllocator * PmmArc::MainAllocator = nullptr;
 
+size_t PmmArc::NodeCount = 1;
+uint32_t PmmArc::NodeDomains[FrameAllocator::MaxNodes] {};
+uint8_t PmmArc::NodeOrder[FrameAllocator::MaxNodes][FrameAllocator::MaxNodes] {};
+
 /****************
     Pmm class
 ****************/
 
+/*  Magazines  */
+
+/**
+ *  A per-core stack of free frames. They remain marked as used in their
+ *  allocation space, so taking and returning them needs no shared lock.
+ */
+template<size_t cap>
+struct FrameMagazine
+{
+    static constexpr size_t const Capacity = cap;
+    static constexpr size_t const Batch = cap / 2;
+
+    size_t Count;
+    paddr_t Frames[cap];
+    FrameDescriptor * Descriptors[cap];
+};
+
+static __thread FrameMagazine<64> SmallMagazine;
+static __thread FrameMagazine<8> LargeMagazine;
+
+template<size_t cap>
+static __hot paddr_t TakeFromMagazine(FrameMagazine<cap> & mag, FrameSize size, uint32_t refCnt)
+{
+    InterruptGuard<> intGuard;
+    //  The magazine belongs to this core.
+
+    if unlikely(mag.Count == 0)
+    {
+        mag.Count = PmmArc::MainAllocator->AllocateFrames(size
+            , mag.Frames, mag.Descriptors, mag.Batch, Cpu::GetData()->NumaNode);
+
+        if unlikely(mag.Count == 0)
+            return nullpaddr;
+    }
+
+    --mag.Count;
+    mag.Descriptors[mag.Count]->Use(refCnt);
+
+    return mag.Frames[mag.Count];
+}
+
+template<size_t cap>
+static __hot size_t TakeManyFromMagazine(FrameMagazine<cap> & mag, FrameSize size
+    , uint32_t refCnt, paddr_t * frames, size_t count)
+{
+    InterruptGuard<> intGuard;
+
+    size_t n = 0;
+
+    while (n < count)
+    {
+        if unlikely(mag.Count == 0)
+        {
+            mag.Count = PmmArc::MainAllocator->AllocateFrames(size
+                , mag.Frames, mag.Descriptors, mag.Batch, Cpu::GetData()->NumaNode);
+
+            if unlikely(mag.Count == 0)
+                break;
+        }
+
+        do
+        {
+            --mag.Count;
+            mag.Descriptors[mag.Count]->Use(refCnt);
+
+            frames[n++] = mag.Frames[mag.Count];
+        } while (n < count && mag.Count > 0);
+    }
+
+    return n;
+}
+
+template<size_t cap>
+static __hot void ReturnToMagazine(FrameMagazine<cap> & mag, FrameSize size
+    , paddr_t frame, FrameDescriptor * desc)
+{
+    InterruptGuard<> intGuard;
+
+    if unlikely(mag.Count == mag.Capacity)
+    {
+        mag.Count -= mag.Batch;
+
+        PmmArc::MainAllocator->FreeFrames(size, mag.Frames + mag.Count, mag.Batch);
+        //  The oldest frames go back; the most recent ones are likely cached.
+    }
+
+    mag.Frames[mag.Count] = frame;
+    mag.Descriptors[mag.Count] = desc;
+    ++mag.Count;
+}
+
+static __hot void ReturnFrame(paddr_t frame, FrameSize size, FrameDescriptor * desc
+    , uint32_t node)
+{
+    frame = RoundDown(frame, size == FrameSize::_4KiB ? PageSize : LargePageSize);
+
+    if (node != Cpu::GetData()->NumaNode)
+        PmmArc::MainAllocator->FreeFrames(size, &frame, 1);
+        //  Remote frames go straight home, so magazines only hand out local
+        //  memory.
+    else if (size == FrameSize::_4KiB)
+        ReturnToMagazine(SmallMagazine, size, frame, desc);
+    else
+        ReturnToMagazine(LargeMagazine, size, frame, desc);
+}
+
+/*  Zeroed Frames  */
+
+static constexpr size_t const ZeroedPoolCapacity = 256;
+
+/**
+ *  A NUMA node's stack of frames which were zeroed ahead of time, by idle
+ *  cores. They are marked as used, with no references.
+ */
+struct ZeroedFramePool
+{
+    SmpLock Lock;
+    size_t Count;
+    paddr_t Frames[ZeroedPoolCapacity];
+};
+
+static ZeroedFramePool ZeroedPools[FrameAllocator::MaxNodes];
+
+static __forceinline ZeroedFramePool & GetZeroedPool()
+{
+    return ZeroedPools[likely(CpuDataSetUp) ? Cpu::GetData()->NumaNode : 0];
+}
+
+paddr_t Pmm::AllocateZeroedFrame()
+{
+    InterruptGuard<> intGuard;
+    //  The pool is refilled by idle threads, which may be preempted.
+
+    ZeroedFramePool & pool = GetZeroedPool();
+
+    withLock (pool.Lock)
+        if likely(pool.Count > 0)
+            return pool.Frames[--pool.Count];
+
+    return nullpaddr;
+}
+
+bool Pmm::StoreZeroedFrame(paddr_t addr)
+{
+    InterruptGuard<> intGuard;
+
+    ZeroedFramePool & pool = GetZeroedPool();
+
+    withLock (pool.Lock)
+        if likely(pool.Count < ZeroedPoolCapacity)
+        {
+            pool.Frames[pool.Count++] = addr;
+
+            return true;
+        }
+
+    return false;
+}
+
+size_t Pmm::GetZeroedFrameShortage()
+{
+    return ZeroedPoolCapacity - GetZeroedPool().Count;
+    //  Merely a hint, so no lock is needed.
+}
+
 /*  Frame operations  */
 
 paddr_t Pmm::AllocateFrame(FrameSize size, AddressMagnitude magn, uint32_t refCnt)
 {
-    //  TODO: NUMA selection of some sorts, maybe based on process?
+    if likely(CpuDataSetUp
+        && (magn == AddressMagnitude::Any || magn == AddressMagnitude::_48bit))
+    {
+        paddr_t ret = nullpaddr;
+
+        if (size == FrameSize::_4KiB)
+            ret = TakeFromMagazine(SmallMagazine, size, refCnt);
+        else if (size == FrameSize::_2MiB)
+            ret = TakeFromMagazine(LargeMagazine, size, refCnt);
+
+        if likely(ret != nullpaddr)
+            return ret;
+    }
+
+    return PmmArc::MainAllocator->AllocateFrame(size, magn, refCnt
+        , likely(CpuDataSetUp) ? Cpu::GetData()->NumaNode : 0);
+    //  Frames come from the core's own node when possible.
+}
+
+size_t Pmm::AllocateFrames(paddr_t * frames, size_t count, FrameSize size, uint32_t refCnt)
+{
+    size_t n = 0;
+
+    if likely(CpuDataSetUp)
+    {
+        if (size == FrameSize::_4KiB)
+            n = TakeManyFromMagazine(SmallMagazine, size, refCnt, frames, count);
+        else if (size == FrameSize::_2MiB)
+            n = TakeManyFromMagazine(LargeMagazine, size, refCnt, frames, count);
+    }
+
+    for (/* nothing */; n < count; ++n)
+        if ((frames[n] = Pmm::AllocateFrame(size, AddressMagnitude::Any, refCnt)) == nullpaddr)
+            break;
+    //  Whatever the magazine could not provide comes from the allocator.
 
-    return PmmArc::MainAllocator->AllocateFrame(size, magn, refCnt);
+    return n;
 }
 
 Handle Pmm::FreeFrame(paddr_t addr, bool ignoreRefCnt)
 {
+    if likely(CpuDataSetUp)
+    {
+        FrameSize size;
+        uint32_t node;
+        FrameDescriptor * const desc = PmmArc::MainAllocator->PeekUsedFrame(addr, size, node);
+
+        if (desc != nullptr)
+        {
+            if (!ignoreRefCnt && desc->ReferenceCount > 1)
+                return HandleResult::PageInUse;
+
+            desc->Use(0);
+            ReturnFrame(addr, size, desc, node);
+
+            return HandleResult::Okay;
+        }
+    }
+
     uint32_t dummy;
 
     return PmmArc::MainAllocator->Mingle(addr, dummy, 0, ignoreRefCnt);
 }
 
+paddr_t Pmm::AllocateContiguous(size_t count, FrameSize size, AddressMagnitude magn, uint32_t refCnt)
+{
+    return PmmArc::MainAllocator->AllocateContiguous(count, size, magn, refCnt
+        , likely(CpuDataSetUp) ? Cpu::GetData()->NumaNode : 0);
+}
+
+Handle Pmm::FreeContiguous(paddr_t addr, size_t count, FrameSize size)
+{
+    size_t const step = size == FrameSize::_4KiB ? PageSize : LargePageSize;
+    Handle res = HandleResult::Okay;
+
+    for (size_t i = 0; i < count; ++i, addr += step)
+    {
+        uint32_t dummy;
+
+        Handle res2 = PmmArc::MainAllocator->Mingle(addr, dummy, 0, true);
+        //  Straight to the allocation space, bypassing the magazines, so the
+        //  run coalesces back into larger frames.
+
+        if unlikely(res2 != HandleResult::Okay && res == HandleResult::Okay)
+            res = res2;
+    }
+
+    return res;
+}
+
 Handle Pmm::ReserveRange(paddr_t start, size_t size, bool includeBusy)
 {
     return PmmArc::MainAllocator->ReserveRange(start, size, includeBusy);
@@ -122,6 +371,21 @@ Handle Pmm::AdjustReferenceCount(paddr_t addr, uint32_t & newCnt, int32_t diff)
     if unlikely(addr == nullpaddr || diff == 0)
         return HandleResult::ArgumentOutOfRange;
 
+    if likely(CpuDataSetUp)
+    {
+        FrameSize size;
+        uint32_t node;
+        FrameDescriptor * const desc = PmmArc::MainAllocator->PeekUsedFrame(addr, size, node);
+
+        if (desc != nullptr)
+        {
+            if ((newCnt = desc->AdjustReferenceCount(diff)) == 0)
+                ReturnFrame(addr, size, desc, node);
+
+            return HandleResult::Okay;
+        }
+    }
+
     return PmmArc::MainAllocator->Mingle(addr, newCnt, diff, false);
 }
 
@@ -191,6 +455,194 @@ Handle PmmArc::CreateAllocationSpace(paddr_t start, paddr_t end)
     }
 }
 
+/*  NUMA  */
+
+static uint32_t GetNode(uint32_t const domain, bool const add)
+{
+    for (size_t i = 0; i < PmmArc::NodeCount; ++i)
+        if (PmmArc::NodeDomains[i] == domain)
+            return (uint32_t)i;
+
+    if (!add || PmmArc::NodeCount == FrameAllocator::MaxNodes)
+        return 0;
+    //  Unknown domains and those beyond the supported count are folded into
+    //  the first node.
+
+    PmmArc::NodeDomains[PmmArc::NodeCount] = domain;
+
+    return (uint32_t)(PmmArc::NodeCount++);
+}
+
+static uint32_t GetDistance(uint32_t const a, uint32_t const b)
+{
+    acpi_table_slit const * const slit = Acpi::SlitPointer;
+    uint64_t const x = PmmArc::NodeDomains[a], y = PmmArc::NodeDomains[b];
+
+    if (slit != nullptr && x < slit->LocalityCount && y < slit->LocalityCount)
+        return slit->Entry[x * slit->LocalityCount + y];
+
+    return a == b ? 10 : 20;
+    //  These are the values the specification assigns to local and remote
+    //  accesses.
+}
+
+Handle PmmArc::ApplyAffinity()
+{
+    acpi_table_srat const * const srat = Acpi::SratPointer;
+
+    if (srat == nullptr)
+        return HandleResult::NotFound;
+
+    size_t const count = NodeCount;
+    NodeCount = 0;
+    //  Nodes are numbered in the order in which the table mentions them.
+
+    uintptr_t const end = (uintptr_t)srat + srat->Header.Length;
+    uintptr_t e = (uintptr_t)srat + sizeof(*srat);
+
+    for (/* nothing */; e < end; e += ((acpi_subtable_header const *)e)->Length)
+    {
+        auto header = (acpi_subtable_header const *)e;
+
+        if unlikely(header->Length == 0)
+            break;
+
+        switch (header->Type)
+        {
+        case ACPI_SRAT_TYPE_CPU_AFFINITY:
+            {
+                auto cpu = (acpi_srat_cpu_affinity const *)e;
+
+                if (0 != (cpu->Flags & ACPI_SRAT_CPU_USE_AFFINITY))
+                    GetNode(cpu->ProximityDomainLo
+                        | ((uint32_t)cpu->ProximityDomainHi[0] <<  8)
+                        | ((uint32_t)cpu->ProximityDomainHi[1] << 16)
+                        | ((uint32_t)cpu->ProximityDomainHi[2] << 24), true);
+            }
+            break;
+
+        case ACPI_SRAT_TYPE_X2APIC_CPU_AFFINITY:
+            {
+                auto cpu = (acpi_srat_x2apic_cpu_affinity const *)e;
+
+                if (0 != (cpu->Flags & ACPI_SRAT_CPU_ENABLED))
+                    GetNode(cpu->ProximityDomain, true);
+            }
+            break;
+
+        case ACPI_SRAT_TYPE_MEMORY_AFFINITY:
+            {
+                auto mem = (acpi_srat_mem_affinity const *)e;
+
+                if (0 == (mem->Flags & ACPI_SRAT_MEM_ENABLED))
+                    break;
+
+                uint32_t const node = GetNode(mem->ProximityDomain, true);
+                paddr_t const start = mem->BaseAddress, limit = start + mem->Length;
+
+                for (FrameAllocationSpace * space = MainAllocator->FirstSpace
+                    ; space != nullptr
+                    ; space = space->Next)
+                    if (space->GetAllocationStart() >= start && space->GetAllocationStart() < limit)
+                        space->Node = node;
+                //  A space belongs to the node which holds its start.
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if unlikely(NodeCount == 0)
+    {
+        NodeCount = count;
+
+        return HandleResult::NotFound;
+    }
+
+    //  Now order the nodes by distance, for every node.
+
+    for (uint32_t a = 0; a < NodeCount; ++a)
+    {
+        for (uint32_t i = 0; i < NodeCount; ++i)
+        {
+            uint32_t const dist = GetDistance(a, i);
+            uint32_t j = i;
+
+            for (/* nothing */; j > 0 && GetDistance(a, NodeOrder[a][j - 1]) > dist; --j)
+                NodeOrder[a][j] = NodeOrder[a][j - 1];
+
+            NodeOrder[a][j] = (uint8_t)i;
+        }
+    }
+
+    //  And finally, chain the spaces of every node, keeping their order of
+    //  preference.
+
+    withLock (MainAllocator->ChainLock)
+    {
+        FrameAllocationSpace * * tails[FrameAllocator::MaxNodes];
+
+        for (size_t i = 0; i < FrameAllocator::MaxNodes; ++i)
+        {
+            MainAllocator->NodeSpaces[i] = nullptr;
+            tails[i] = MainAllocator->NodeSpaces + i;
+        }
+
+        for (FrameAllocationSpace * space = MainAllocator->LastSpace
+            ; space != nullptr
+            ; space = space->Previous)
+        {
+            space->NodeNext = nullptr;
+
+            *(tails[space->Node]) = space;
+            tails[space->Node] = &(space->NodeNext);
+        }
+    }
+
+    return HandleResult::Okay;
+}
+
+uint32_t PmmArc::GetApicNode(uint32_t apicId)
+{
+    acpi_table_srat const * const srat = Acpi::SratPointer;
+
+    if (srat == nullptr || NodeCount < 2)
+        return 0;
+
+    uintptr_t const end = (uintptr_t)srat + srat->Header.Length;
+    uintptr_t e = (uintptr_t)srat + sizeof(*srat);
+
+    for (/* nothing */; e < end; e += ((acpi_subtable_header const *)e)->Length)
+    {
+        auto header = (acpi_subtable_header const *)e;
+
+        if unlikely(header->Length == 0)
+            break;
+
+        if (header->Type == ACPI_SRAT_TYPE_CPU_AFFINITY)
+        {
+            auto cpu = (acpi_srat_cpu_affinity const *)e;
+
+            if (cpu->ApicId == apicId && 0 != (cpu->Flags & ACPI_SRAT_CPU_USE_AFFINITY))
+                return GetNode(cpu->ProximityDomainLo
+                    | ((uint32_t)cpu->ProximityDomainHi[0] <<  8)
+                    | ((uint32_t)cpu->ProximityDomainHi[1] << 16)
+                    | ((uint32_t)cpu->ProximityDomainHi[2] << 24), false);
+        }
+        else if (header->Type == ACPI_SRAT_TYPE_X2APIC_CPU_AFFINITY)
+        {
+            auto cpu = (acpi_srat_x2apic_cpu_affinity const *)e;
+
+            if (cpu->ApicId == apicId && 0 != (cpu->Flags & ACPI_SRAT_CPU_ENABLED))
+                return GetNode(cpu->ProximityDomain, false);
+        }
+    }
+
+    return 0;
+}
+
 /*  Relocation  */
 
 void PmmArc::Remap(FrameAllocator * & alloc, vaddr_t const oldVaddr, vaddr_t const newVaddr)
@@ -249,6 +701,8 @@ FrameAllocationSpace::FrameAllocationSpace(paddr_t phys_start, paddr_t phys_end)
     , SplitFree(LargeFrameDescriptor::NullIndex)
     , Next(nullptr)
     , Previous(nullptr)
+    , Node(0)
+    , NodeNext(nullptr)
 {
     paddr_t const algn_end = RoundDown(phys_end, 2 << 20);
     //  Round down the end to a two-megabyte address.
@@ -279,198 +733,564 @@ FrameAllocationSpace::FrameAllocationSpace(paddr_t phys_start, paddr_t phys_end)
             ctrl_end = new_ctrl_end;
             alloc_start = new_alloc_start;
 
-            if unlikely(new_ctrl_end == new_alloc_start)
-                break;
-            //  If this is a precise fit, no need to loop further.
+            if unlikely(new_ctrl_end == new_alloc_start)
+                break;
+            //  If this is a precise fit, no need to loop further.
+        }
+    }
+
+    ASSERTX(frameCount > 0
+        , "Failed to squeeze any frames in allocation space.")
+        (phys_start)(phys_end)XEND;
+
+    ASSERTX(alloc_start + (frameCount << 21) == algn_end
+        , "Sanity failure: %XP + %Xs != %XP??"
+        , alloc_start, frameCount << 21, algn_end)XEND;
+    //  Just checking sanity.
+
+    this->AllocationStart = alloc_start;
+    this->AllocationEnd   = algn_end;
+    this->AllocableSize   = algn_end - alloc_start;
+
+    this->ControlAreaSize = frameCount * sizeof(LargeFrameDescriptor);
+    this->FreeSize        = this->AllocableSize;
+
+    this->LargeFrameCount = frameCount;
+
+    uint32_t * lastNextIndex = &(this->LargeFree);
+
+    for (size_t i = 0; i < frameCount; ++i)
+    {
+        *lastNextIndex = i;
+        //  Construct the pseudo-stack of free large frames.
+
+        auto desc = new (this->Map + i) LargeFrameDescriptor();
+        desc->SubDescriptors = reinterpret_cast<SmallFrameDescriptor *>(alloc_start + (i << 21));
+
+        lastNextIndex = &(desc->NextIndex);
+    }
+
+    *lastNextIndex = LargeFrameDescriptor::NullIndex;
+
+    //  So, it's almost ready. There may be a stray frame at the end that can be
+    //  used partially. Enough space for another descriptor is also necessary.
+
+    if unlikely(alloc_start - ctrl_end >= sizeof(LargeFrameDescriptor) && phys_end - algn_end >= (3 * PageSize))
+    {
+        this->AllocationEnd = phys_end;
+        this->AllocableSize = phys_end - alloc_start;
+
+        this->ControlAreaSize += sizeof(LargeFrameDescriptor);
+        this->FreeSize        += phys_end - algn_end - PageSize;
+
+        SplitLargeFrame(new (this->Map + frameCount) LargeFrameDescriptor(), (phys_end - algn_end) / PageSize - 2);
+
+        this->SplitFree = frameCount;
+
+        ++this->LargeFrameCount;
+    }
+}
+
+/*  Split Frames  */
+
+paddr_t FrameAllocationSpace::PopSmallFrame(uint32_t refCnt)
+{
+    uint32_t const lIndex = this->SplitFree;
+
+    if (lIndex == LargeFrameDescriptor::NullIndex)
+        return nullpaddr;
+
+    //  Reaching this point means a non-full split frame exists!
+
+    LargeFrameDescriptor * const lDesc = this->Map + lIndex;
+    uint16_t const sIndex = lDesc->GetExtras()->NextFree;
+    SmallFrameDescriptor * sDesc = nullptr;
+
+    assert_or(sIndex != SmallFrameDescriptor::NullIndex
+        , "Invalid split frame state!")
+    {
+        //  This should *not* happen, ever.
+
+        goto split_frame_full;
+    }
+
+    sDesc = lDesc->SubDescriptors + sIndex;
+    sDesc->Use(refCnt);
+
+    lDesc->GetExtras()->NextFree = sDesc->NextIndex;
+    lDesc->GetExtras()->FreeCount -= 1;
+
+    if unlikely(sDesc->NextIndex == SmallFrameDescriptor::NullIndex)
+    {
+        //  This was the last small frame in the split frame.
+
+    split_frame_full:
+        lDesc->Status = FrameStatus::Full;
+
+        uint32_t next = lDesc->NextIndex;
+        this->SplitFree = next;
+
+        if likely(next != LargeFrameDescriptor::NullIndex)
+            this->Map[next].GetExtras()->PrevIndex = LargeFrameDescriptor::NullIndex;
+        //  No more previous frame for the next frame.
+
+        onRelease if (sIndex == SmallFrameDescriptor::NullIndex)
+            return nullpaddr;
+        //  In release mode, this rather odd situation is tolerated.
+    }
+
+    return this->AllocationStart + ((paddr_t)lIndex << 21) + ((paddr_t)sIndex << 12);
+}
+
+bool FrameAllocationSpace::PushSmallFrame(uint32_t lIndex, uint16_t sIndex)
+{
+    LargeFrameDescriptor * const lDesc = this->Map + lIndex;
+    SmallFrameDescriptor * const sDesc = lDesc->SubDescriptors + sIndex;
+
+    sDesc->NextIndex = lDesc->GetExtras()->NextFree;
+    lDesc->GetExtras()->NextFree = sIndex;
+    uint16_t subDescCnt = lDesc->GetExtras()->FreeCount += 1;
+
+    if unlikely(lDesc->Status == FrameStatus::Full)
+    {
+        //  Split frame used to be full, but not anymore. So it can
+        //  be added to the stack of non-full split frames.
+
+        lDesc->Status = FrameStatus::Split;
+
+        uint32_t next = this->SplitFree;
+
+        lDesc->NextIndex = next;
+        this->SplitFree = lIndex;
+
+        if likely(next != LargeFrameDescriptor::NullIndex)
+            this->Map[next].GetExtras()->PrevIndex = lIndex;
+
+        lDesc->GetExtras()->PrevIndex = LargeFrameDescriptor::NullIndex;
+    }
+    else if unlikely(subDescCnt == LargeFrameDescriptor::SubDescriptorsCount)
+    {
+        //  All small frames within the split frame are free, so it
+        //  can be freed completely.
+
+        uint32_t next = lDesc->NextIndex, prev = lDesc->GetExtras()->PrevIndex;
+
+        if (next != LargeFrameDescriptor::NullIndex)
+            this->Map[next].GetExtras()->PrevIndex = prev;
+        if (prev != LargeFrameDescriptor::NullIndex)
+            this->Map[prev].NextIndex = next;
+
+        if (this->SplitFree == lIndex)
+            this->SplitFree = next;
+
+        return true;
+    }
+
+    return false;
+}
+
+/*  Frame manipulation  */
+
+paddr_t FrameAllocationSpace::AllocateFrame(FrameSize size, uint32_t refCnt)
+{
+    switch (size)
+    {
+    case FrameSize::_64KiB:
+        return this->AllocateContiguous(16, FrameSize::_4KiB, refCnt);
+    case FrameSize::_4MiB:
+        return this->AllocateContiguous(2, FrameSize::_2MiB, refCnt);
+        //  These are served as naturally-aligned runs of smaller frames.
+
+    case FrameSize::_1GiB:
+        FAIL("A request was made for a frame size which is not supported by this architecture.");
+
+        return nullpaddr;
+
+    default:
+        break;
+    }
+
+    // MSG_("** AllocateFrame %s **%n", size == FrameSize::_4KiB ? "4 KiB" : "2 MiB");
+
+    uint32_t lIndex = LargeFrameDescriptor::NullIndex;
+    uint16_t sIndex = SmallFrameDescriptor::NullIndex;
+    LargeFrameDescriptor * lDesc = nullptr;
+    paddr_t paddr = nullpaddr;
+
+    if (size == FrameSize::_4KiB)
+    {
+        withLock (this->SplitLocker)
+            paddr = this->PopSmallFrame(refCnt);
+
+        if (paddr != nullpaddr)
+            return paddr;
+        //  Otherwise, there was no non-full split frame.
+    }
+
+    withLock (this->LargeLocker)
+    {
+        lIndex = this->LargeFree;
+
+        if (lIndex == LargeFrameDescriptor::NullIndex)
+            return nullpaddr;
+
+        //  Reaching this point means a non-full split frame exists!
+
+        lDesc = this->Map + lIndex;
+
+        this->LargeFree = lDesc->NextIndex;
+        paddr = this->AllocationStart + (lIndex << 21);
+
+        if (size == FrameSize::_2MiB)
+        {
+            lDesc->Use(refCnt);
+
+            return paddr;
+        }
+    }
+
+    //  At this point, `lIndex`, `paddr` and `lDesc` are valid.
+
+    SplitLargeFrame(lDesc);
+
+    sIndex = lDesc->GetExtras()->NextFree;
+    SmallFrameDescriptor * const sDesc = lDesc->SubDescriptors + sIndex;
+
+    sDesc->Use(refCnt);
+
+    lDesc->GetExtras()->NextFree = sDesc->NextIndex;
+    lDesc->GetExtras()->FreeCount -= 1;
+
+    withLock (this->SplitLocker)
+    {
+        //  Gotta put this frame on top of the stack.
+
+        uint32_t next = this->SplitFree;
+
+        lDesc->NextIndex = next;
+        this->SplitFree = lIndex;
+
+        if likely(next != LargeFrameDescriptor::NullIndex)
+            this->Map[next].GetExtras()->PrevIndex = lIndex;
+    }
+
+    return this->AllocationStart + (lIndex << 21) + (sIndex << 12);
+}
+
+/*  Contiguous Frames  */
+
+/**
+ *  Gets the alignment, in frames, of a run of the given length. Runs are
+ *  aligned to their size rounded up to a power of two, like buddy blocks.
+ */
+static __forceinline size_t GetRunAlignment(size_t count, size_t cap)
+{
+    size_t align = 1;
+
+    while (align < count && align < cap)
+        align <<= 1;
+
+    return align;
+}
+
+paddr_t FrameAllocationSpace::AllocateContiguous(size_t count, FrameSize size, uint32_t refCnt)
+{
+    if unlikely(count == 0)
+        return nullpaddr;
+
+    if (size == FrameSize::_4KiB)
+    {
+        if unlikely(count > LargeFrameDescriptor::SubDescriptorsCount)
+            return nullpaddr;
+        //  Larger runs must be made of large frames.
+
+        return this->AllocateSmallRun(count, refCnt);
+    }
+    else if (size == FrameSize::_2MiB)
+        return this->AllocateLargeRun(count, refCnt);
+
+    return nullpaddr;
+}
+
+paddr_t FrameAllocationSpace::AllocateSmallRun(size_t count, uint32_t refCnt)
+{
+    size_t align = GetRunAlignment(count, 16);
+    //  64 KiB is the largest alignment needed of small runs.
+
+    if (align + count > 512)
+        align = 1;
+    //  The longest runs cannot afford it, as index 0 is never available.
+
+    auto findRun = [count, align](LargeFrameDescriptor * lDesc)
+    {
+        for (size_t first = align; first + count <= 512; first += align)
+        {
+            size_t i = 0;
+
+            while (i < count && lDesc->SubDescriptors[first + i].Status == FrameStatus::Free)
+                ++i;
+
+            if (i == count)
+                return (uint16_t)first;
         }
-    }
 
-    ASSERTX(frameCount > 0
-        , "Failed to squeeze any frames in allocation space.")
-        (phys_start)(phys_end)XEND;
+        return SmallFrameDescriptor::NullIndex;
+        //  Index 0 is never free, so it is a fine sentinel.
+    };
 
-    ASSERTX(alloc_start + (frameCount << 21) == algn_end
-        , "Sanity failure: %XP + %Xs != %XP??"
-        , alloc_start, frameCount << 21, algn_end)XEND;
-    //  Just checking sanity.
+    withLock (this->SplitLocker)
+    {
+        for (uint32_t lIndex = this->SplitFree
+            ; lIndex != LargeFrameDescriptor::NullIndex
+            ; lIndex = this->Map[lIndex].NextIndex)
+        {
+            LargeFrameDescriptor * const lDesc = this->Map + lIndex;
 
-    this->AllocationStart = alloc_start;
-    this->AllocationEnd   = algn_end;
-    this->AllocableSize   = algn_end - alloc_start;
+            if (lDesc->GetExtras()->FreeCount < count)
+                continue;
 
-    this->ControlAreaSize = frameCount * sizeof(LargeFrameDescriptor);
-    this->FreeSize        = this->AllocableSize;
+            uint16_t const first = findRun(lDesc);
 
-    this->LargeFrameCount = frameCount;
+            if (first != SmallFrameDescriptor::NullIndex)
+                return this->ClaimSmallRun(lIndex, first, count, refCnt);
+        }
+    }
 
-    uint32_t * lastNextIndex = &(this->LargeFree);
+    //  No split frame has such a run, so a large frame is split for it.
 
-    for (size_t i = 0; i < frameCount; ++i)
+    uint32_t lIndex;
+
+    withLock (this->LargeLocker)
     {
-        *lastNextIndex = i;
-        //  Construct the pseudo-stack of free large frames.
+        lIndex = this->LargeFree;
 
-        auto desc = new (this->Map + i) LargeFrameDescriptor();
-        desc->SubDescriptors = reinterpret_cast<SmallFrameDescriptor *>(alloc_start + (i << 21));
+        if (lIndex == LargeFrameDescriptor::NullIndex)
+            return nullpaddr;
 
-        lastNextIndex = &(desc->NextIndex);
+        this->LargeFree = this->Map[lIndex].NextIndex;
     }
 
-    *lastNextIndex = LargeFrameDescriptor::NullIndex;
+    LargeFrameDescriptor * const lDesc = this->Map + lIndex;
 
-    //  So, it's almost ready. There may be a stray frame at the end that can be
-    //  used partially. Enough space for another descriptor is also necessary.
+    SplitLargeFrame(lDesc);
 
-    if unlikely(alloc_start - ctrl_end >= sizeof(LargeFrameDescriptor) && phys_end - algn_end >= (3 * PageSize))
+    withLock (this->SplitLocker)
     {
-        this->AllocationEnd = phys_end;
-        this->AllocableSize = phys_end - alloc_start;
-
-        this->ControlAreaSize += sizeof(LargeFrameDescriptor);
-        this->FreeSize        += phys_end - algn_end - PageSize;
+        uint32_t next = this->SplitFree;
 
-        SplitLargeFrame(new (this->Map + frameCount) LargeFrameDescriptor(), (phys_end - algn_end) / PageSize - 2);
+        lDesc->NextIndex = next;
+        this->SplitFree = lIndex;
 
-        this->SplitFree = frameCount;
+        if likely(next != LargeFrameDescriptor::NullIndex)
+            this->Map[next].GetExtras()->PrevIndex = lIndex;
 
-        ++this->LargeFrameCount;
+        return this->ClaimSmallRun(lIndex, (uint16_t)align, count, refCnt);
+        //  The first aligned index is always good in a fresh split frame.
     }
-}
 
-/*  Frame manipulation  */
+    return nullpaddr;
+}
 
-paddr_t FrameAllocationSpace::AllocateFrame(FrameSize size, uint32_t refCnt)
+paddr_t FrameAllocationSpace::ClaimSmallRun(uint32_t lIndex, uint16_t first, size_t count
+    , uint32_t refCnt)
 {
-    switch (size)
-    {
-    case FrameSize::_64KiB: //  TODO: Use 4-KiB frames to provide this.
-    case FrameSize::_4MiB:  //  TODO: Use 2-MiB frames to provide this.
-    case FrameSize::_1GiB:
-        FAIL("A request was made for a frame size which is not supported by this architecture.");
+    LargeFrameDescriptor * const lDesc = this->Map + lIndex;
+    SplitFrameExtra * const extra = lDesc->GetExtras();
+    size_t const last = first + count;
 
-        return nullpaddr;
+    for (size_t i = first; i < last; ++i)
+        lDesc->SubDescriptors[i].Use(refCnt);
 
-    default:
-        break;
-    }
+    //  The claimed frames are spliced out of the split frame's pseudo-stack.
 
-    // MSG_("** AllocateFrame %s **%n", size == FrameSize::_4KiB ? "4 KiB" : "2 MiB");
+    uint16_t * link = &(extra->NextFree);
 
-    uint32_t lIndex = LargeFrameDescriptor::NullIndex;
-    uint16_t sIndex = SmallFrameDescriptor::NullIndex;
-    LargeFrameDescriptor * lDesc = nullptr;
-    paddr_t paddr = nullpaddr;
+    while (*link != SmallFrameDescriptor::NullIndex)
+    {
+        uint16_t const index = *link;
 
-    if (size == FrameSize::_4KiB)
+        if (index >= first && index < last)
+            *link = lDesc->SubDescriptors[index].NextIndex;
+        else
+            link = &(lDesc->SubDescriptors[index].NextIndex);
+    }
+
+    extra->FreeCount -= count;
+
+    if (extra->FreeCount == 0)
     {
-        withLock (this->SplitLocker)
-        {
-            //  No large frame was pre-selected.
+        //  Full now, so it leaves the stack of non-full split frames.
 
-            lIndex = this->SplitFree;
+        uint32_t next = lDesc->NextIndex, prev = extra->PrevIndex;
 
-            if (lIndex == LargeFrameDescriptor::NullIndex)
-                goto grab_large_page;
+        if (next != LargeFrameDescriptor::NullIndex)
+            this->Map[next].GetExtras()->PrevIndex = prev;
+        if (prev != LargeFrameDescriptor::NullIndex)
+            this->Map[prev].NextIndex = next;
 
-            // MSG_("   Split free: %u4%n", lIndex);
+        if (this->SplitFree == lIndex)
+            this->SplitFree = next;
 
-            //  Reaching this point means a non-full split frame exists!
+        lDesc->Status = FrameStatus::Full;
+    }
 
-            lDesc = this->Map + lIndex;
-            sIndex = lDesc->GetExtras()->NextFree;
-            SmallFrameDescriptor * const sDesc = lDesc->SubDescriptors + sIndex;
+    return this->AllocationStart + ((paddr_t)lIndex << 21) + ((paddr_t)first << 12);
+}
 
-            assert_or(sIndex != SmallFrameDescriptor::NullIndex
-                , "Invalid split frame state!")
-            {
-                //  This should *not* happen, ever.
+paddr_t FrameAllocationSpace::AllocateLargeRun(size_t count, uint32_t refCnt)
+{
+    size_t const align = GetRunAlignment(count, 512);
+    //  Up to 1 GiB.
 
-                goto split_frame_full;
-            }
+    size_t const frameCount = (this->AllocationEnd - this->AllocationStart) >> 21;
+    size_t const skew = (this->AllocationStart >> 21) & (align - 1);
+    //  The space itself is only guaranteed to be aligned to 2 MiB.
+
+    withLock (this->LargeLocker)
+    {
+        size_t first = (align - skew) & (align - 1);
 
-            // MSG_("   Small frame index: %u2 (-> %u2)%n", sIndex, sDesc->NextIndex);
+        for (/* nothing */; first + count <= frameCount; first += align)
+        {
+            size_t i = 0;
 
-            sDesc->Use(refCnt);
+            while (i < count && this->Map[first + i].Status == FrameStatus::Free)
+                ++i;
 
-            lDesc->GetExtras()->NextFree = sDesc->NextIndex;
-            lDesc->GetExtras()->FreeCount -= 1;
+            if (i == count)
+                break;
+        }
 
-            if unlikely(sDesc->NextIndex == SmallFrameDescriptor::NullIndex)
-            {
-                //  This was the last small frame in the split frame.
+        if (first + count > frameCount)
+            return nullpaddr;
 
-            split_frame_full:
-                lDesc->Status = FrameStatus::Full;
+        for (size_t i = first; i < first + count; ++i)
+            this->Map[i].Use(refCnt);
 
-                uint32_t next = lDesc->NextIndex;
-                this->SplitFree = next;
+        //  And out of the pseudo-stack of free large frames they go.
 
-                if likely(next != LargeFrameDescriptor::NullIndex)
-                    this->Map[next].GetExtras()->PrevIndex = LargeFrameDescriptor::NullIndex;
-                //  No more previous frame for the next frame.
+        uint32_t * link = &(this->LargeFree);
 
-                // MSG_("   Split frame depleted; Next: %u4%n", this->SplitFree);
+        while (*link != LargeFrameDescriptor::NullIndex)
+        {
+            uint32_t const index = *link;
 
-                onRelease if (sIndex == SmallFrameDescriptor::NullIndex)
-                    goto grab_large_page;
-                //  In release mode, this rather odd situation is tolerated.
-            }
+            if (index >= first && index < first + count)
+                *link = this->Map[index].NextIndex;
+            else
+                link = &(this->Map[index].NextIndex);
         }
 
-        // MSG_("   Returning address %XP **%n", this->AllocationStart + (lIndex << 21) + (sIndex << 12));
-
-        return this->AllocationStart + (lIndex << 21) + (sIndex << 12);
+        return this->AllocationStart + ((paddr_t)first << 21);
     }
 
-grab_large_page:
-    withLock (this->LargeLocker)
+    return nullpaddr;
+}
+
+size_t FrameAllocationSpace::AllocateFrames(FrameSize size, paddr_t * frames
+    , FrameDescriptor * * descs, size_t count)
+{
+    size_t n = 0;
+
+    if (size == FrameSize::_4KiB)
     {
-        lIndex = this->LargeFree;
+        while (n < count)
+        {
+            withLock (this->SplitLocker)
+                while (n < count)
+                {
+                    paddr_t const paddr = this->PopSmallFrame(0);
 
-        if (lIndex == LargeFrameDescriptor::NullIndex)
-            return nullpaddr;
+                    if (paddr == nullpaddr)
+                        break;
 
-        //  Reaching this point means a non-full split frame exists!
+                    frames[n++] = paddr;
+                }
 
-        lDesc = this->Map + lIndex;
+            if (n == count)
+                break;
 
-        this->LargeFree = lDesc->NextIndex;
-        paddr = this->AllocationStart + (lIndex << 21);
+            //  The split frames ran out, so a large frame is split and the
+            //  rest is taken from it in the next round.
 
-        if (size == FrameSize::_2MiB)
+            paddr_t const paddr = this->AllocateFrame(size, 0);
+
+            if (paddr == nullpaddr)
+                break;
+
+            frames[n++] = paddr;
+        }
+
+        for (size_t i = 0; i < n; ++i)
         {
-            lDesc->Use(refCnt);
+            paddr_t const offset = frames[i] - this->AllocationStart;
 
-            return paddr;
+            descs[i] = this->Map[offset >> 21].SubDescriptors + ((offset & 0x1FF000) >> 12);
         }
     }
+    else if (size == FrameSize::_2MiB)
+    {
+        withLock (this->LargeLocker)
+            while (n < count && this->LargeFree != LargeFrameDescriptor::NullIndex)
+            {
+                uint32_t const lIndex = this->LargeFree;
+                LargeFrameDescriptor * const lDesc = this->Map + lIndex;
 
-    //  At this point, `lIndex`, `paddr` and `lDesc` are valid.
+                this->LargeFree = lDesc->NextIndex;
+                lDesc->Use(0);
 
-    SplitLargeFrame(lDesc);
+                frames[n] = this->AllocationStart + ((paddr_t)lIndex << 21);
+                descs[n++] = lDesc;
+            }
+    }
 
-    sIndex = lDesc->GetExtras()->NextFree;
-    SmallFrameDescriptor * const sDesc = lDesc->SubDescriptors + sIndex;
+    return n;
+}
 
-    sDesc->Use(refCnt);
+void FrameAllocationSpace::FreeFrames(FrameSize size, paddr_t const * frames, size_t count)
+{
+    if (size == FrameSize::_4KiB)
+    {
+        uint32_t reclaimed[count];
+        size_t reclaimedCount = 0;
 
-    lDesc->GetExtras()->NextFree = sDesc->NextIndex;
-    lDesc->GetExtras()->FreeCount -= 1;
+        withLock (this->SplitLocker)
+            for (size_t i = 0; i < count; ++i)
+            {
+                uint32_t const lIndex = (uint32_t)((frames[i] - this->AllocationStart) >> 21UL);
+                uint16_t const sIndex = (uint16_t)((frames[i] & 0x1FF000) >> 12);
 
-    withLock (this->SplitLocker)
-    {
-        //  Gotta put this frame on top of the stack.
+                this->Map[lIndex].SubDescriptors[sIndex].Free();
 
-        uint32_t next = this->SplitFree;
+                if unlikely(this->PushSmallFrame(lIndex, sIndex))
+                    reclaimed[reclaimedCount++] = lIndex;
+            }
 
-        lDesc->NextIndex = next;
-        this->SplitFree = lIndex;
+        if likely(reclaimedCount == 0)
+            return;
 
-        if likely(next != LargeFrameDescriptor::NullIndex)
-            this->Map[next].GetExtras()->PrevIndex = lIndex;
+        for (size_t i = 0; i < reclaimedCount; ++i)
+            this->Map[reclaimed[i]].Free();
+
+        withLock (this->LargeLocker)
+            for (size_t i = 0; i < reclaimedCount; ++i)
+            {
+                this->Map[reclaimed[i]].NextIndex = this->LargeFree;
+                this->LargeFree = reclaimed[i];
+            }
     }
+    else
+    {
+        withLock (this->LargeLocker)
+            for (size_t i = 0; i < count; ++i)
+            {
+                uint32_t const lIndex = (uint32_t)((frames[i] - this->AllocationStart) >> 21UL);
 
-    return this->AllocationStart + (lIndex << 21) + (sIndex << 12);
+                this->Map[lIndex].Free();
+                this->Map[lIndex].NextIndex = this->LargeFree;
+                this->LargeFree = lIndex;
+            }
+    }
 }
 
 Handle FrameAllocationSpace::Mingle(paddr_t addr, uint32_t & newCnt, int32_t diff, bool ignoreRefCnt)
@@ -619,44 +1439,8 @@ do_small_frame:
             {
                 sDesc->Free();
 
-                sDesc->NextIndex = lDesc->GetExtras()->NextFree;
-                lDesc->GetExtras()->NextFree = sIndex;
-                uint16_t subDescCnt = lDesc->GetExtras()->FreeCount += 1;
-
-                if unlikely(lDesc->Status == FrameStatus::Full)
-                {
-                    //  Split frame used to be full, but not anymore. So it can
-                    //  be added to the stack of non-full split frames.
-
-                    lDesc->Status = FrameStatus::Split;
-
-                    uint32_t next = this->SplitFree;
-
-                    lDesc->NextIndex = next;
-                    this->SplitFree = lIndex;
-
-                    if likely(next != LargeFrameDescriptor::NullIndex)
-                        this->Map[next].GetExtras()->PrevIndex = lIndex;
-
-                    lDesc->GetExtras()->PrevIndex = LargeFrameDescriptor::NullIndex;
-                }
-                else if unlikely(subDescCnt == LargeFrameDescriptor::SubDescriptorsCount)
-                {
-                    //  All small frames within the split frame are free, so it
-                    //  can be freed completely.
-
-                    uint32_t next = lDesc->NextIndex, prev = lDesc->GetExtras()->PrevIndex;
-
-                    if (next != LargeFrameDescriptor::NullIndex)
-                        this->Map[next].GetExtras()->PrevIndex = prev;
-                    if (prev != LargeFrameDescriptor::NullIndex)
-                        this->Map[prev].NextIndex = next;
-
-                    if (this->SplitFree == lIndex)
-                        this->SplitFree = next;
-
+                if unlikely(this->PushSmallFrame(lIndex, sIndex))
                     goto reclaim_large_frame;
-                }
 
                 return HandleResult::Okay;
             }
@@ -882,63 +1666,165 @@ do_small_frame:
     return HandleResult::IntegrityFailure;
 }
 
+FrameDescriptor * FrameAllocationSpace::PeekUsedFrame(paddr_t addr, FrameSize & size)
+{
+    if (addr < this->AllocationStart || addr >= this->AllocationEnd)
+        return nullptr;
+
+    uint32_t lIndex = (uint32_t)((addr - this->AllocationStart) >> 21UL);
+    LargeFrameDescriptor * lDesc = this->Map + lIndex;
+    uint16_t sIndex = (uint16_t)((addr & 0x1FF000) >> 12);
+
+    //  No lock is needed while the caller holds a reference to the frame, as
+    //  neither status can change until it is dropped.
+
+    switch (lDesc->Status)
+    {
+    case FrameStatus::Used:
+        size = FrameSize::_2MiB;
+
+        return lDesc;
+
+    case FrameStatus::Split:
+    case FrameStatus::Full:
+        if unlikely(sIndex == 0)
+            return nullptr;
+        //  This one holds the split frame's extras.
+
+        size = FrameSize::_4KiB;
+
+        if (lDesc->SubDescriptors[sIndex].Status == FrameStatus::Used)
+            return lDesc->SubDescriptors + sIndex;
+
+        return nullptr;
+
+    default:
+        return nullptr;
+    }
+}
+
 /***************************
     FrameAllocator class
 ***************************/
 
 /*  Page Manipulation  */
 
-paddr_t FrameAllocator::AllocateFrame(FrameSize size, AddressMagnitude magn, uint32_t refCnt)
+/**
+ *  Tries the given function on the spaces which satisfy the address magnitude,
+ *  in order of preference for the given node, until it returns a frame.
+ */
+template<typename TFunc>
+static __hot paddr_t TrySpaces(FrameAllocator * alloc, AddressMagnitude magn, uint32_t node
+    , TFunc func)
 {
-    paddr_t ret = nullpaddr;
-    FrameAllocationSpace * space;
+    if (magn == AddressMagnitude::_24bit || magn == AddressMagnitude::_16bit)
+    {
+        //  TODO: 24-bit and 16-bit addresses, maybeh?
+
+        FAIL("Unable to serve frames of address magnitude %s."
+            , (magn == AddressMagnitude::_24bit) ? "24-bit" : "16-bit");
 
-    if (magn == AddressMagnitude::Any || magn == AddressMagnitude::_48bit)
+        return nullpaddr;
+    }
+
+    auto tryOne = [magn, &func](FrameAllocationSpace * space)
     {
-        //  Any space is alright.
+        if (magn == AddressMagnitude::_32bit && space->GetAllocationEnd() > (1ULL << 32))
+            return nullpaddr;
+        //  The condition checks that the allocation space ends at a 32-bit
+        //  address. (all the other addresses are less, thus have to be 32-bit
+        //  if the end is)
 
-        space = this->LastSpace;
+        return func(space);
+    };
 
-        while (space != nullptr)
-        {
-            ret = space->AllocateFrame(size, refCnt);
+    paddr_t ret = nullpaddr;
 
-            if (ret != nullpaddr)
-                return ret;
+    if (PmmArc::NodeCount > 1)
+    {
+        //  Nodes are tried from the nearest to the farthest.
 
-            space = space->Previous;
-        }
+        for (size_t i = 0; i < PmmArc::NodeCount; ++i)
+            for (FrameAllocationSpace * space = alloc->NodeSpaces[PmmArc::NodeOrder[node][i]]
+                ; space != nullptr
+                ; space = space->NodeNext)
+                if ((ret = tryOne(space)) != nullpaddr)
+                    return ret;
     }
-    else if (magn == AddressMagnitude::_32bit)
+    else
     {
-        space = this->LastSpace;
+        for (FrameAllocationSpace * space = alloc->LastSpace
+            ; space != nullptr
+            ; space = space->Previous)
+            if ((ret = tryOne(space)) != nullpaddr)
+                return ret;
+    }
 
-        while (space != nullptr)
-        {
-            if (space->GetAllocationEnd() <= (1ULL << 32))
-            {
-                //  The condition checks that the allocation space ends
-                //  at a 32-bit address. (all the other addresses are less,
-                //  thus have to be 32-bit if the end is)
+    return nullpaddr;
+}
+
+paddr_t FrameAllocator::AllocateFrame(FrameSize size, AddressMagnitude magn, uint32_t refCnt
+    , uint32_t node)
+{
+    return TrySpaces(this, magn, node, [size, refCnt](FrameAllocationSpace * space)
+    {
+        return space->AllocateFrame(size, refCnt);
+    });
+}
 
-                ret = space->AllocateFrame(size, refCnt);
+paddr_t FrameAllocator::AllocateContiguous(size_t count, FrameSize size, AddressMagnitude magn
+    , uint32_t refCnt, uint32_t node)
+{
+    return TrySpaces(this, magn, node, [count, size, refCnt](FrameAllocationSpace * space)
+    {
+        return space->AllocateContiguous(count, size, refCnt);
+    });
+}
 
-                if (ret != nullpaddr)
-                    return ret;
-            }
+size_t FrameAllocator::AllocateFrames(FrameSize size, paddr_t * frames
+    , FrameDescriptor * * descs, size_t count, uint32_t node)
+{
+    size_t n = 0;
 
-            space = space->Previous;
-        }
+    if (PmmArc::NodeCount > 1)
+    {
+        for (size_t i = 0; i < PmmArc::NodeCount && n < count; ++i)
+            for (FrameAllocationSpace * space = this->NodeSpaces[PmmArc::NodeOrder[node][i]]
+                ; space != nullptr && n < count
+                ; space = space->NodeNext)
+                n += space->AllocateFrames(size, frames + n, descs + n, count - n);
     }
     else
     {
-        //  TODO: 24-bit and 16-bit addresses, maybeh?
-
-        FAIL("Unable to serve frames of address magnitude %s."
-            , (magn == AddressMagnitude::_24bit) ? "24-bit" : "16-bit");
+        for (FrameAllocationSpace * space = this->LastSpace
+            ; space != nullptr && n < count
+            ; space = space->Previous)
+            n += space->AllocateFrames(size, frames + n, descs + n, count - n);
     }
 
-    return nullpaddr;
+    return n;
+}
+
+void FrameAllocator::FreeFrames(FrameSize size, paddr_t const * frames, size_t count)
+{
+    size_t i = 0;
+
+    while (i < count)
+    {
+        FrameAllocationSpace * const space = this->GetSpace(frames[i]);
+
+        assert(space != nullptr, "Frame %XP belongs to no allocation space.", frames[i]);
+
+        size_t j = i + 1;
+
+        while (j < count && space->ContainsRange(frames[j], 1))
+            ++j;
+        //  Consecutive frames of the same space are freed together.
+
+        space->FreeFrames(size, frames + i, j - i);
+
+        i = j;
+    }
 }
 
 Handle FrameAllocator::Mingle(paddr_t addr, uint32_t & newCnt, int32_t diff, bool ignoreRefCnt)
@@ -995,6 +1881,18 @@ Handle FrameAllocator::GetFrameInfo(paddr_t addr, FrameSize & size, uint32_t & r
     return HandleResult::PagesOutOfAllocatorRange;
 }
 
+FrameDescriptor * FrameAllocator::PeekUsedFrame(paddr_t addr, FrameSize & size, uint32_t & node)
+{
+    FrameAllocationSpace * const space = this->GetSpace(addr);
+
+    if (space == nullptr)
+        return nullptr;
+
+    node = space->Node;
+
+    return space->PeekUsedFrame(addr, size);
+}
+
 bool FrameAllocator::ContainsRange(paddr_t start, psize_t size)
 {
     FrameAllocationSpace const * space = this->FirstSpace;
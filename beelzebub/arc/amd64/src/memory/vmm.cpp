@@ -67,6 +67,9 @@ static __forceinline bool Is4KiBAligned(TInt val) { return (val & (     PageSize
 template<typename TInt>
 static __forceinline bool Is2MiBAligned(TInt val) { return (val & (LargePageSize - 1)) == 0; }
 
+static __hot bool DeferFrameRelease(paddr_t const frame);
+static __hot void FlushUserland(Process * proc);
+
 /****************
     Vmm class
 ****************/
@@ -77,6 +80,7 @@ bool VmmArc::Page1GB = false;
 bool VmmArc::NX = false;
 bool VmmArc::PCID = false;
 __thread paddr_t VmmArc::LastAlienPml4;
+__thread uint64_t VmmArc::LocalPcidGeneration;
 
 static uintptr_t BootstrapKVasAddr;
 static size_t const BootstrapKVasPageCount = 3;
@@ -88,6 +92,64 @@ inline void Alienate(Process * proc)
     pml4[VmmArc::AlienFractalIndex] = Pml4Entry(proc->PagingTable, true, true, false, VmmArc::NX);
 }
 
+/*  PCIDs  */
+
+static SmpLock PcidLock {};
+static Atomic<uint64_t> PcidGeneration {1};
+static uint64_t NextPcid = 1;
+//  PCID 0 is left to the cores which haven't enabled PCIDs yet.
+
+static __hot uint64_t AcquirePcid(Process * proc)
+{
+    uint64_t tag = proc->Pcid.Load();
+
+    if likely((tag >> 12) == PcidGeneration.Load())
+        return tag;
+
+    withLock (PcidLock)
+    {
+        tag = proc->Pcid.Load();
+
+        if ((tag >> 12) != PcidGeneration.Load())
+        {
+            if (NextPcid > Cr3::PcidBits)
+            {
+                ++PcidGeneration;
+                NextPcid = 1;
+                //  Out of PCIDs, so a new generation starts. Every core will
+                //  flush its TLB when it first switches to a process of this
+                //  generation, and processes of the previous one will be given
+                //  new PCIDs when they are switched to.
+            }
+
+            tag = (PcidGeneration.Load() << 12) | NextPcid++;
+
+            proc->Pcid.Store(tag);
+        }
+    }
+
+    return tag;
+}
+
+/**
+ *  Gets the PCID which tags the TLB entries of the given process on the
+ *  current core, or 0 if `invlpg` reaches them.
+ */
+static __hot __forceinline uint64_t GetForeignPcid(Process * proc)
+{
+    if (!VmmArc::PCID || !CpuDataSetUp || proc == Cpu::GetProcess())
+        return 0;
+
+    uint64_t const tag = proc->Pcid.Load();
+
+    if ((tag >> 12) != VmmArc::LocalPcidGeneration)
+        return 0;
+    //  This core cannot have entries tagged with this PCID for the process;
+    //  it will flush before it uses it.
+
+    return tag & Cr3::PcidBits;
+}
+
 /*  Statics  */
 
 vaddr_t Vmm::UserlandStart = 1ULL << 21;    //  2 MiB
@@ -95,6 +157,9 @@ vaddr_t Vmm::UserlandEnd = VmmArc::LowerHalfEnd;
 vaddr_t Vmm::KernelStart = VmmArc::KernelHeapStart;
 vaddr_t Vmm::KernelEnd = VmmArc::KernelHeapEnd;
 
+size_t Vmm::FullFlushThreshold = 32;
+size_t Vmm::FaultAroundPages = 16;
+
 /*  Initialization  */
 
 Handle Vmm::Bootstrap(Process * const bootstrapProc)
@@ -324,18 +389,60 @@ Handle Vmm::Initialize(Process * proc)
     }
 
     return proc->Vas.Initialize(UserlandStart, UserlandEnd
-        , &AcquirePoolInKernelHeap, &EnlargePoolInKernelHeap, &ReleasePoolFromKernelHeap);
+        , &AcquirePoolInKernelHeap, &EnlargePoolInKernelHeap, &ReleasePoolFromKernelHeap
+        , PoolReleaseOptions::NoRelease);
+    //  Region lookups without the lock may read nodes which are being freed,
+    //  so their memory must stay mapped.
 }
 
 /*  Activation and Status  */
 
 Handle Vmm::Switch(Process * const oldProc, Process * const newProc)
 {
-    (void)oldProc;
+    size_t const core = likely(oldProc != nullptr) ? Cpu::GetData()->Index : 0;
+    //  Only process switches have an old process, and they happen on cores
+    //  which are fully set up.
+
+    if likely(oldProc != nullptr)
+        newProc->ActiveCores.Add(core);
+    //  Joining before the switch means concurrent shootdowns cannot miss this
+    //  core once it may cache translations of the new process.
+
+    Cr3 newVal = Cr3(newProc->PagingTable, false, false);
+
+    if (!VmmArc::PCID || !Cpu::GetCr4().GetPcide())
+    {
+        Cpu::SetCr3(newVal);
+
+        if likely(oldProc != nullptr)
+            oldProc->ActiveCores.Remove(core);
+        //  The TLB holds none of its translations anymore.
+
+        return HandleResult::Okay;
+    }
+
+    //  With PCIDs, this core remains in the old process' set, because its
+    //  translations are kept. It leaves lazily, when it receives a shootdown
+    //  for that process.
+
+    uint64_t const tag = AcquirePcid(newProc);
+    newVal.SetPcid(tag & Cr3::PcidBits);
 
-    Cr3 const newVal = Cr3(newProc->PagingTable, false, false);
+    if likely((tag >> 12) == VmmArc::LocalPcidGeneration)
+        Cpu::SetCr3(newVal.SetNoFlush(true));
+        //  The TLB entries of the process are still good.
+    else
+    {
+        Cpu::SetCr3(newVal);
+        CpuInstructions::InvalidateTlbAllContexts();
+        //  Entries tagged with PCIDs of an older generation may belong to
+        //  processes which no longer own the PCIDs.
+
+        VmmArc::LocalPcidGeneration = tag >> 12;
+    }
 
-    Cpu::SetCr3(newVal);
+    VmmArc::LastAlienPml4 = nullpaddr;
+    //  The alien fractal mapping may have been cached under this PCID before.
 
     return HandleResult::Okay;
 }
@@ -595,6 +702,9 @@ do_pml2e:
             return HandleResult::Okay;
         }
     }
+    else if unlikely(pml2p->operator[](ind).GetPageSize())
+        return HandleResult::PageMapped;
+    //  There is no PML1 under a large page.
     
     ind = VmmArc::GetPml1Index(vaddr);
 
@@ -768,6 +878,567 @@ Handle Vmm::MapRange(Process * proc
     return HandleResult::Okay;
 }
 
+static __thread vaddr_t ScratchWindow;
+
+Handle Vmm::FillFrame(paddr_t const frame, void const * const src, uint8_t const fill)
+{
+    if unlikely(!CpuDataSetUp)
+        return HandleResult::UnsupportedOperation;
+    //  The window is per-core.
+
+    if unlikely(ScratchWindow == nullvaddr)
+    {
+        vaddr_t vaddr = nullvaddr;
+
+        Handle res = Vmm::AllocatePages(nullptr, PageSize
+            , MemoryAllocationOptions::Reserve | MemoryAllocationOptions::VirtualKernelHeap
+            , MemoryFlags::Global | MemoryFlags::Writable
+            , MemoryContent::Generic, vaddr);
+
+        if unlikely(!res.IsOkayResult())
+            return res;
+
+        ScratchWindow = vaddr;
+    }
+
+    Handle res;
+
+    withInterrupts (false)
+    {
+        res = Vmm::MapPage(nullptr, ScratchWindow, frame
+            , MemoryFlags::Global | MemoryFlags::Writable
+            , MemoryMapOptions::NoReferenceCounting);
+
+        if likely(res == HandleResult::Okay)
+        {
+            if (src != nullptr)
+                memcpy(reinterpret_cast<void *>(ScratchWindow), src, PageSize);
+            else if (fill == 0)
+                CpuInstructions::ZeroNonTemporal(reinterpret_cast<void *>(ScratchWindow), PageSize);
+            else
+                memset(reinterpret_cast<void *>(ScratchWindow), fill, PageSize);
+
+            VmmArc::GetLocalPml1Entry(ScratchWindow) = Pml1Entry();
+            CpuInstructions::InvalidateTlb(reinterpret_cast<void const *>(ScratchWindow));
+            //  No other core ever touches this window, so no shootdown is
+            //  needed.
+        }
+    }
+
+    return res;
+}
+
+size_t Vmm::PrepareZeroedFrames(size_t count)
+{
+    count = Minimum(count, Pmm::GetZeroedFrameShortage());
+
+    size_t n = 0;
+
+    for (/* nothing */; n < count; ++n)
+    {
+        paddr_t const frame = Pmm::AllocateFrame();
+
+        if unlikely(frame == nullpaddr)
+            break;
+
+        if unlikely(Vmm::FillFrame(frame, nullptr) != HandleResult::Okay
+                 || !Pmm::StoreZeroedFrame(frame))
+        {
+            Pmm::FreeFrame(frame);
+
+            break;
+        }
+    }
+
+    return n;
+}
+
+Handle Vmm::MapPages(Process * proc
+    , uintptr_t const vaddr, paddr_t const * frames, size_t const count
+    , MemoryFlags const flags, uint64_t & mapped
+    , MemoryMapOptions opts)
+{
+    mapped = 0;
+
+    if unlikely(count == 0)
+        return HandleResult::Okay;
+
+    if unlikely((vaddr >= VmmArc::FractalStart && vaddr < VmmArc::FractalEnd     )
+             || (vaddr >= VmmArc::LowerHalfEnd && vaddr < VmmArc::HigherHalfStart))
+        return HandleResult::PageMapIllegalRange;
+
+    if unlikely(!Is4KiBAligned(vaddr))
+        return HandleResult::AlignmentFailure;
+
+    if unlikely(count > 64
+        || RoundDown(vaddr, LargePageSize) != RoundDown(vaddr + (count - 1) * PageSize, LargePageSize))
+        return HandleResult::ArgumentOutOfRange;
+    //  All the pages need to share a PML1.
+
+    Handle res;
+
+    if (proc == nullptr)
+        proc = likely(CpuDataSetUp) ? Cpu::GetProcess() : &BootstrapProcess;
+
+    bool const nonLocal = (vaddr < VmmArc::LowerHalfEnd) && !Vmm::IsActive(proc);
+
+    SmpLock * alienLock = nullptr, * heapLock = nullptr;
+
+    if (nonLocal && CpuDataSetUp)
+        alienLock = &(Cpu::GetProcess()->AlienPagingTablesLock);
+
+    if (0 == (opts & MemoryMapOptions::NoLocking))
+        heapLock = (vaddr < VmmArc::LowerHalfEnd
+            ? &(proc->LocalTablesLock)
+            : &(Vmm::KernelHeapLock));
+
+    withInterrupts (false)
+    {
+        //  THE SCOPE IS OPTIONALLY LOCK-GUARDED AS WELL!
+
+        LockGuardFlexible<SmpLock > pml4Lg {alienLock};
+        LockGuardFlexible<SmpLock > heapLg {heapLock};
+
+        size_t i = 0;
+
+        for (/* nothing */; i < count; ++i)
+        {
+            res = MapPageInternal(proc, vaddr + i * PageSize, frames[i]
+                , FrameSize::_4KiB, flags
+                , false, false, nonLocal);
+
+            if likely(res == HandleResult::Okay)
+            {
+                mapped |= 1ULL << i;
+
+                break;
+            }
+            else if (res != HandleResult::PageMapped)
+                return res;
+        }
+
+        //  Once one page is mapped, its PML1 is known to exist, so the rest of
+        //  the entries are filled in directly.
+
+        Pml1 * const pml1p = nonLocal
+            ? VmmArc::GetAlienPml1(vaddr)
+            : VmmArc::GetLocalPml1(vaddr);
+
+        for (++i; i < count; ++i)
+        {
+            Pml1Entry & pml1e = pml1p->operator[](VmmArc::GetPml1Index(vaddr + i * PageSize));
+
+            if (pml1e.GetPresent())
+                continue;
+
+            pml1e = Pml1Entry(frames[i], true
+                , 0 != (flags & MemoryFlags::Writable)
+                , 0 != (flags & MemoryFlags::Userland)
+                , 0 != (flags & MemoryFlags::Global)
+                , 0 == (flags & MemoryFlags::Executable) && VmmArc::NX);
+            //  Present, writable, user-accessible, global, executable.
+
+            mapped |= 1ULL << i;
+        }
+    }
+
+    if (0 == (opts & MemoryMapOptions::NoReferenceCounting))
+        for (size_t i = 0; i < count; ++i)
+            if (0 != (mapped & (1ULL << i)))
+            {
+                res = Pmm::AdjustReferenceCount(frames[i], 1);
+
+                if unlikely(!res.IsOkayResult() && !res.IsResult(HandleResult::PagesOutOfAllocatorRange))
+                    return res;
+            }
+
+    return HandleResult::Okay;
+}
+
+Handle Vmm::ReplacePage(Process * proc, uintptr_t const vaddr
+    , paddr_t const expected, paddr_t const paddr
+    , MemoryFlags const flags, MemoryMapOptions opts)
+{
+    if unlikely(!Is4KiBAligned(vaddr) || !Is4KiBAligned(paddr))
+        return HandleResult::AlignmentFailure;
+
+    if (proc == nullptr) proc = likely(CpuDataSetUp) ? Cpu::GetProcess() : &BootstrapProcess;
+
+    Handle res = TryTranslate(proc, vaddr, [vaddr, expected, paddr, flags](PmlCommonEntry * pE, int level)
+    {
+        if unlikely(pE->GetAddress() != expected)
+            return HandleResult::PageMapped;
+        //  Another thread got here first.
+
+        if (level == 1)
+            *reinterpret_cast<Pml1Entry *>(pE) = Pml1Entry(paddr, true
+                , 0 != (flags & MemoryFlags::Writable)
+                , 0 != (flags & MemoryFlags::Userland)
+                , 0 != (flags & MemoryFlags::Global)
+                , 0 == (flags & MemoryFlags::Executable) && VmmArc::NX);
+        else if likely(Is2MiBAligned(vaddr) && Is2MiBAligned(paddr))
+            *reinterpret_cast<Pml2Entry *>(pE) = Pml2Entry(paddr, true
+                , 0 != (flags & MemoryFlags::Writable)
+                , 0 != (flags & MemoryFlags::Userland)
+                , 0 != (flags & MemoryFlags::Global)
+                , 0 == (flags & MemoryFlags::Executable) && VmmArc::NX);
+        else
+            return HandleResult::AlignmentFailure;
+        //  Present, writable, user-accessible, global, executable.
+
+        return HandleResult::Okay;
+    }, 0 == (opts & MemoryMapOptions::NoLocking));
+
+    if unlikely(res != HandleResult::Okay)
+        return res;
+
+    Vmm::InvalidatePage(proc, vaddr, true);
+
+    if (0 == (opts & MemoryMapOptions::NoReferenceCounting))
+    {
+        Pmm::AdjustReferenceCount(paddr, 1);
+
+        if (!DeferFrameRelease(expected))
+            Pmm::AdjustReferenceCount(expected, -1);
+        //  Only after no core can reach the old frame anymore.
+    }
+
+    return HandleResult::Okay;
+}
+
+Handle Vmm::ClaimPage(Process * proc, uintptr_t const vaddr
+    , paddr_t const expected, MemoryFlags const flags)
+{
+    if (proc == nullptr) proc = likely(CpuDataSetUp) ? Cpu::GetProcess() : &BootstrapProcess;
+
+    Handle res = TryTranslate(proc, vaddr, [expected, flags](PmlCommonEntry * pE, int level)
+    {
+        (void)level;
+
+        if unlikely(pE->GetAddress() != expected)
+            return HandleResult::PageMapped;
+        //  Another thread got here first.
+
+        FrameSize size;
+        uint32_t refCnt;
+
+        if unlikely(!Pmm::GetFrameInfo(expected, size, refCnt).IsOkayResult() || refCnt != 1)
+            return HandleResult::PageMapped;
+        //  Shared again meanwhile.
+
+        PmlCommonEntry e = *pE;
+
+        e.SetGlobal( ((MemoryFlags::Global     & flags) != 0))
+        .SetUserland(((MemoryFlags::Userland   & flags) != 0))
+        .SetWritable(((MemoryFlags::Writable   & flags) != 0))
+        .SetXd( VmmArc::NX & ((MemoryFlags::Executable & flags) == 0));
+
+        *pE = e;
+
+        return HandleResult::Okay;
+    }, true);
+
+    if unlikely(res != HandleResult::Okay)
+        return res;
+
+    return Vmm::InvalidatePage(proc, vaddr, true);
+}
+
+/*  Cloning  */
+
+/**
+ *  Gives a new, blank paging table to the given entry of the child process.
+ */
+template<typename TEntry>
+static __cold Handle LinkChildTable(TEntry & entry, void * const table)
+{
+    paddr_t const frame = Pmm::AllocateFrame(1);
+
+    if unlikely(frame == nullpaddr)
+        return HandleResult::OutOfMemory;
+
+    entry = TEntry(frame, true, true, true, false);
+    //  Present, writable, user-accessible, executable.
+
+    CpuInstructions::InvalidateTlb(table);
+    memset(table, 0, PageSize);
+
+    return HandleResult::Okay;
+}
+
+/**
+ *  Takes another reference to the frame mapped by the given entry of the parent
+ *  process, and write-protects it, returning the child's copy of the entry.
+ */
+static __cold PmlCommonEntry ShareEntry(PmlCommonEntry & entry)
+{
+    Handle res = Pmm::AdjustReferenceCount(entry.GetAddress(), 1);
+
+    if (res.IsOkayResult())
+        entry.SetWritable(false);
+    //  The first write to either copy will fault and be copied. Frames outside
+    //  of the allocator, like device memory, remain truly shared.
+
+    return entry;
+}
+
+/**
+ *  Points the alien fractal mapping at the given child process again, for a
+ *  walk resuming after interrupts were let through. Other threads may have
+ *  used the alien mapping on this core meanwhile.
+ */
+static __cold void RealienateChild(Process * child, vaddr_t const va4, paddr_t const last)
+{
+    Alienate(child);
+
+    CpuInstructions::InvalidateTlb(VmmArc::GetAlienPml4());
+    CpuInstructions::InvalidateTlb(VmmArc::GetAlienPml3(va4));
+    //  Deeper tables are only reached right after being linked or checked.
+
+    VmmArc::LastAlienPml4 = last;
+}
+
+/**
+ *  Clones the tables under one present PML3 entry of the parent process. The
+ *  tables are locked for as long as this takes.
+ */
+static __cold Handle CloneTablesUnder(Process * parent, Process * child, vaddr_t const va3)
+{
+    uint16_t const i4 = VmmArc::GetPml4Index(va3), i3 = VmmArc::GetPml3Index(va3);
+    vaddr_t const va4 = (vaddr_t)i4 << 39;
+
+    LockGuard<SmpLock > pml4Lg {parent->AlienPagingTablesLock};
+    LockGuard<SmpLock > heapLg {parent->LocalTablesLock};
+
+    RealienateChild(child, va4, child->PagingTable);
+
+    Pml4 & pml4c = *(VmmArc::GetAlienPml4());
+    Pml3 & pml3c = *(VmmArc::GetAlienPml3(va4));
+
+    Handle res = HandleResult::Okay;
+
+    if (!pml4c[i4].GetPresent()
+        && (res = LinkChildTable(pml4c[i4], &pml3c)) != HandleResult::Okay)
+        return res;
+
+    if unlikely((res = LinkChildTable(pml3c[i3], VmmArc::GetAlienPml2(va3))) != HandleResult::Okay)
+        return res;
+
+    Pml2 & pml2p = *(VmmArc::GetLocalPml2(va3));
+    Pml2 & pml2c = *(VmmArc::GetAlienPml2(va3));
+
+    for (uint16_t i2 = 0; i2 < 512; ++i2)
+    {
+        if (!pml2p[i2].GetPresent())
+            continue;
+
+        if (pml2p[i2].GetPageSize())
+        {
+            static_cast<PmlCommonEntry &>(pml2c[i2]) = ShareEntry(pml2p[i2]);
+
+            continue;
+        }
+
+        vaddr_t const va2 = va3 | ((vaddr_t)i2 << 21);
+
+        if unlikely((res = LinkChildTable(pml2c[i2], VmmArc::GetAlienPml1(va2))) != HandleResult::Okay)
+            return res;
+
+        Pml1 & pml1p = *(VmmArc::GetLocalPml1(va2));
+        Pml1 & pml1c = *(VmmArc::GetAlienPml1(va2));
+
+        for (uint16_t i1 = 0; i1 < 512; ++i1)
+            if (pml1p[i1].GetPresent())
+                static_cast<PmlCommonEntry &>(pml1c[i1]) = ShareEntry(pml1p[i1]);
+    }
+
+    return HandleResult::Okay;
+}
+
+Handle Vmm::CloneTables(Process * parent, Process * child)
+{
+    if unlikely(!CpuDataSetUp || parent != Cpu::GetProcess())
+        return HandleResult::UnsupportedOperation;
+    //  The parent's tables are reached through the local fractal mapping, and
+    //  the child's through the alien one.
+
+    Handle res = HandleResult::Okay;
+
+    Pml4 & pml4p = *(VmmArc::GetLocalPml4());
+
+    for (uint16_t i4 = 0; i4 < 256 && res == HandleResult::Okay; ++i4)
+    {
+        if (!pml4p[i4].GetPresent())
+            continue;
+        //  Tables are never taken out of a live process, so they can be looked
+        //  for without the lock. Those which appear later only hold pages
+        //  mapped after the walk began.
+
+        vaddr_t const va4 = (vaddr_t)i4 << 39;
+
+        Pml3 & pml3p = *(VmmArc::GetLocalPml3(va4));
+
+        for (uint16_t i3 = 0; i3 < 512 && res == HandleResult::Okay; ++i3)
+            if (pml3p[i3].GetPresent())
+                withInterrupts (false)
+                    res = CloneTablesUnder(parent, child, va4 | ((vaddr_t)i3 << 30));
+        //  Interrupts are let through between PML3 entries.
+    }
+
+    FlushUserland(parent);
+    //  The parent may still hold writable translations of what it now shares.
+
+    return res;
+}
+
+/**
+ *  Drops the reference a discarded child process held to the frame mapped by
+ *  the given entry. The parent may write to the frame again once it holds the
+ *  only reference. The parent's regions must be locked.
+ */
+static __cold void UnshareEntry(Process * parent, PmlCommonEntry * const parentEntry
+    , PmlCommonEntry const & childEntry, vaddr_t const vaddr)
+{
+    paddr_t const frame = childEntry.GetAddress();
+    uint32_t newCnt;
+
+    if (!Pmm::AdjustReferenceCount(frame, newCnt, -1).IsOkayResult() || newCnt != 1)
+        return;
+    //  Frames outside of the allocator were never write-protected, and frames
+    //  still shared with others must stay so.
+
+    if (parentEntry == nullptr || !parentEntry->GetPresent()
+        || parentEntry->GetAddress() != frame)
+        return;
+    //  The parent may have copied the page meanwhile.
+
+    MemoryRegion const * const reg = parent->Vas.FindRegion(vaddr);
+
+    if (reg != nullptr && 0 != (reg->Flags & MemoryFlags::Writable))
+        parentEntry->SetWritable(true);
+    //  Stale read-only translations only cause a fault which finds the frame
+    //  unshared.
+}
+
+/**
+ *  Discards the child's tables under one PML3 entry, returning false if the
+ *  PML4 entry above it is not present. The tables are locked for as long as
+ *  this takes.
+ */
+static __cold bool DiscardTablesUnder(Process * parent, Process * child, vaddr_t const va3)
+{
+    uint16_t const i4 = VmmArc::GetPml4Index(va3), i3 = VmmArc::GetPml3Index(va3);
+    vaddr_t const va4 = (vaddr_t)i4 << 39;
+
+    LockGuard<SmpLock > pml4Lg {parent->AlienPagingTablesLock};
+    LockGuard<SmpLock > heapLg {parent->LocalTablesLock};
+
+    RealienateChild(child, va4, nullpaddr);
+    //  The child's tables are being freed.
+
+    Pml4 & pml4p = *(VmmArc::GetLocalPml4());
+    Pml4 & pml4c = *(VmmArc::GetAlienPml4());
+
+    if (!pml4c[i4].GetPresent())
+        return false;
+
+    Pml3 & pml3c = *(VmmArc::GetAlienPml3(va4));
+
+    if (!pml3c[i3].GetPresent())
+        return true;
+
+    Pml3 * const pml3p = pml4p[i4].GetPresent() ? VmmArc::GetLocalPml3(va4) : nullptr;
+
+    Pml2 * const pml2p = (pml3p != nullptr && (*pml3p)[i3].GetPresent())
+        ? VmmArc::GetLocalPml2(va3) : nullptr;
+    Pml2 & pml2c = *(VmmArc::GetAlienPml2(va3));
+
+    CpuInstructions::InvalidateTlb(&pml2c);
+
+    for (uint16_t i2 = 0; i2 < 512; ++i2)
+    {
+        if (!pml2c[i2].GetPresent())
+            continue;
+
+        vaddr_t const va2 = va3 | ((vaddr_t)i2 << 21);
+
+        if (pml2c[i2].GetPageSize())
+        {
+            UnshareEntry(parent, pml2p != nullptr ? &((*pml2p)[i2]) : nullptr
+                , pml2c[i2], va2);
+
+            continue;
+        }
+
+        Pml1 * const pml1p = (pml2p != nullptr && (*pml2p)[i2].GetPresent()
+                                               && !(*pml2p)[i2].GetPageSize())
+            ? VmmArc::GetLocalPml1(va2) : nullptr;
+        Pml1 & pml1c = *(VmmArc::GetAlienPml1(va2));
+
+        CpuInstructions::InvalidateTlb(&pml1c);
+
+        for (uint16_t i1 = 0; i1 < 512; ++i1)
+            if (pml1c[i1].GetPresent())
+                UnshareEntry(parent, pml1p != nullptr ? &((*pml1p)[i1]) : nullptr
+                    , pml1c[i1], va2 | ((vaddr_t)i1 << 12));
+
+        Pmm::FreeFrame(pml2c[i2].GetAddress());
+    }
+
+    Pmm::FreeFrame(pml3c[i3].GetAddress());
+
+    return true;
+}
+
+void Vmm::DiscardTables(Process * parent, Process * child)
+{
+    if unlikely(child->PagingTable == nullpaddr)
+        return;
+
+    if likely(CpuDataSetUp && parent == Cpu::GetProcess())
+    {
+        for (uint16_t i4 = 0; i4 < 256; ++i4)
+        {
+            vaddr_t const va4 = (vaddr_t)i4 << 39;
+            bool present = true;
+
+            for (uint16_t i3 = 0; i3 < 512 && present; ++i3)
+                withInterrupts (false)
+                {
+                    parent->Vas.Lock.AcquireAsReader();
+                    //  The parent's regions are looked up, so they must not
+                    //  change meanwhile. This lock is taken before the tables'.
+
+                    present = DiscardTablesUnder(parent, child, va4 | ((vaddr_t)i3 << 30));
+
+                    parent->Vas.Lock.ReleaseAsReader();
+                }
+            //  Interrupts are let through between PML3 entries.
+        }
+
+        withInterrupts (false)
+        {
+            LockGuard<SmpLock > pml4Lg {parent->AlienPagingTablesLock};
+
+            Alienate(child);
+
+            Pml4 & pml4c = *(VmmArc::GetAlienPml4());
+
+            CpuInstructions::InvalidateTlb(&pml4c);
+            VmmArc::LastAlienPml4 = nullpaddr;
+
+            for (uint16_t i4 = 0; i4 < 256; ++i4)
+                if (pml4c[i4].GetPresent())
+                    Pmm::FreeFrame(pml4c[i4].GetAddress());
+        }
+    }
+    //  Only CloneTables fills in the userland tables of a child, and it has
+    //  the same requirements.
+
+    Pmm::FreeFrame(child->PagingTable);
+    child->PagingTable = nullpaddr;
+}
+
 Handle Vmm::UnmapPage(Process * proc, uintptr_t const vaddr
     , paddr_t & paddr, FrameSize & size, MemoryMapOptions opts)
 {
@@ -791,7 +1462,7 @@ Handle Vmm::UnmapPage(Process * proc, uintptr_t const vaddr
 
     Vmm::InvalidatePage(proc, vaddr, true);
 
-    if (0 == (opts & MemoryMapOptions::NoReferenceCounting))
+    if (0 == (opts & MemoryMapOptions::NoReferenceCounting) && !DeferFrameRelease(paddr))
         Pmm::AdjustReferenceCount(paddr, -1);
 
     return HandleResult::Okay;
@@ -897,7 +1568,10 @@ static __hot Handle UnmapIteratively(IterativeUnmapState * const state)
         {
             do
             {
-                Handle res2 = Pmm::AdjustReferenceCount(UnmapList[--i].PhysicalAddress, -1);
+                if (DeferFrameRelease(UnmapList[--i].PhysicalAddress))
+                    continue;
+
+                Handle res2 = Pmm::AdjustReferenceCount(UnmapList[i].PhysicalAddress, -1);
 
         #ifdef __BEELZEBUB__CONF_DEBUG
                 ASSERTX(res2 == HandleResult::Okay
@@ -1030,6 +1704,9 @@ bail:
             {
                 assert(tmp->Frame != nullpaddr);
 
+                if (DeferFrameRelease(tmp->Frame))
+                    continue;
+
                 Handle res2 = Pmm::AdjustReferenceCount(tmp->Frame, -1);
 
         #ifdef __BEELZEBUB__CONF_DEBUG
@@ -1087,6 +1764,10 @@ Handle Vmm::UnmapRange(Process * proc
 
     Handle res;
 
+    Vmm::BeginInvalidationBatch();
+    //  The chunks below are invalidated together, in as few shootdowns as
+    //  possible, once the whole range is unmapped.
+
     if likely(CpuDataSetUp)
     {
         IterativeUnmapState state {
@@ -1110,7 +1791,7 @@ Handle Vmm::UnmapRange(Process * proc
             res = UnmapIteratively(&state);
 
             if (res != HandleResult::Okay)
-                return res;
+                break;
         } while (state.Address < state.EndAddress);
     }
     else
@@ -1140,12 +1821,14 @@ Handle Vmm::UnmapRange(Process * proc
             res = UnmapRecursively(&state, nullptr);
 
             if (res != HandleResult::Okay)
-                return res;
+                break;
 
             state.Depth = 0;
         } while (state.Address < state.EndAddress);
     }
 
+    Vmm::EndInvalidationBatch();
+
     return res;
 }
 
@@ -1153,18 +1836,388 @@ Handle Vmm::UnmapRange(Process * proc
     Page Invaidation    >-------------------------------------------------------
 ***********************/
 
+/**
+ *  Drops all the userland translations of a process on a core which was sent a
+ *  shootdown but isn't running that process anymore. The core leaves the
+ *  process' set, so further shootdowns skip it until it switches back.
+ */
+static __hot bool DropInactiveTranslations(Process * proc)
+{
+    if (proc == Cpu::GetProcess())
+        return false;
+
+    if (VmmArc::PCID)
+    {
+        uint64_t const tag = proc->Pcid.Load();
+
+        if ((tag >> 12) == VmmArc::LocalPcidGeneration)
+            CpuInstructions::InvalidateTlbContext(tag & Cr3::PcidBits);
+        //  One instruction for the whole address space, no matter how many
+        //  pages are being invalidated.
+    }
+
+    proc->ActiveCores.Remove(Cpu::GetData()->Index);
+
+    return true;
+}
+
+/**
+ *  Runs an invalidator on this core and on every other core which may cache
+ *  translations of the given address, and waits for all of them.
+ */
+static __hot void Shootdown(Process * proc, vaddr_t const vaddr
+    , MailFunction const remote, MailFunction const local, void * const info)
+{
+    if (vaddr < Vmm::UserlandStart || vaddr >= Vmm::UserlandEnd)
+    {
+        //  Kernel mappings are shared by all processes.
+
+        ALLOCATE_MAIL_BROADCAST(mail, remote, info);
+        mail.SetAwait(true).Post(local, info);
+
+        return;
+    }
+
+    InterruptGuard<> intGuard;
+    //  This core must not change while the targets are chosen.
+
+    asm volatile ( "mfence \n\t" : : : "memory" );
+    //  The page table changes must be visible before the set is read, otherwise
+    //  a core which is just switching to the process could be missed.
+
+    size_t const count = Cores::GetCount();
+    size_t const self = Cpu::GetData()->Index;
+
+    uint32_t targets[count];
+    unsigned int targetCount = 0;
+
+    proc->ActiveCores.ForEach(count, [&targets, &targetCount, self](size_t core)
+    {
+        if (core != self)
+            targets[targetCount++] = (uint32_t)core;
+    });
+
+    if (targetCount == 0)
+        return local(info);
+
+    ALLOCATE_MAIL(mail, targetCount, remote, info);
+
+    for (unsigned int i = 0; i < targetCount; ++i)
+        mail.Links[i] = MailboxEntryLink(targets[i]);
+
+    mail.SetAwait(true).Post(local, info);
+}
+
+static __hot __forceinline void InvalidateAddress(void const * const addr
+    , uint64_t const pcid)
+{
+    if (pcid != 0 && (uintptr_t)addr < Vmm::UserlandEnd)
+        CpuInstructions::InvalidateTlb(addr, pcid);
+    else
+        CpuInstructions::InvalidateTlb(addr);
+}
+
+/**
+ *  Drops all the translations of a process on this core, along with the global
+ *  ones when kernel mappings are involved.
+ */
+static __hot void FlushTranslations(Process * proc, bool const kernel)
+{
+    bool const pcide = VmmArc::PCID && Cpu::GetCr4().GetPcide();
+
+    if (kernel)
+    {
+        if (pcide)
+            CpuInstructions::InvalidateTlbEverything();
+        else
+        {
+            Cr4 cr4 = Cpu::GetCr4();
+
+            if (cr4.GetPge())
+            {
+                Cpu::SetCr4(cr4.SetPge(false));
+                Cpu::SetCr4(cr4.SetPge(true));
+                //  Toggling this bit also drops global translations.
+            }
+            else
+                Cpu::SetCr3(Cpu::GetCr3());
+        }
+    }
+    else if (pcide)
+    {
+        uint64_t const tag = proc->Pcid.Load();
+
+        if ((tag >> 12) == VmmArc::LocalPcidGeneration)
+            CpuInstructions::InvalidateTlbContext(tag & Cr3::PcidBits);
+        //  Otherwise, this core holds no translations under this tag.
+    }
+    else if (proc == nullptr || proc == Cpu::GetProcess())
+        Cpu::SetCr3(Cpu::GetCr3());
+    //  Without PCIDs, a foreign process has nothing in this TLB.
+}
+
+/*  Batches  */
+
+static constexpr size_t const BatchAddressCapacity = 64;
+static constexpr size_t const BatchFrameCapacity = 512;
+
+struct InvalidationBatch
+{
+    Thread * Owner;
+    //  The thread whose invalidations are gathered here.
+
+    Process * Proc;
+    bool Kernel;
+
+    size_t Count;
+    void * Addresses[BatchAddressCapacity];
+
+    size_t FrameCount;
+    paddr_t Frames[BatchFrameCapacity];
+};
+
+struct BatchInvalidationInfo
+{
+    Process * const Proc;
+    bool const Kernel;
+    size_t const Count;
+    void * const * const Addresses;
+};
+
+static __thread InvalidationBatch Batch;
+
+template<bool caller>
+static __hot __solid void BatchInvalidator(void * cookie)
+{
+    BatchInvalidationInfo const * const inf = (BatchInvalidationInfo const *)cookie;
+
+    if (!caller && !inf->Kernel && DropInactiveTranslations(inf->Proc))
+        return;
+
+    if (inf->Count > Vmm::FullFlushThreshold || inf->Count > BatchAddressCapacity)
+        return FlushTranslations(inf->Proc, inf->Kernel);
+    //  Addresses beyond the capacity were counted but not recorded.
+
+    uint64_t const pcid = inf->Proc == nullptr ? 0 : GetForeignPcid(inf->Proc);
+
+    for (size_t i = 0; i < inf->Count; ++i)
+        InvalidateAddress(inf->Addresses[i], pcid);
+
+    COMPILER_MEMORY_BARRIER();
+}
+
+/**
+ *  Performs the invalidations gathered in this core's batch, and only then
+ *  releases the frames which were unmapped along with them.
+ */
+static __hot void FlushBatch()
+{
+    if (Batch.Count > 0)
+    {
+        BatchInvalidationInfo info { Batch.Proc, Batch.Kernel
+            , Batch.Count, Batch.Addresses };
+
+        if likely(Mailbox::IsReady())
+            Shootdown(Batch.Proc
+                , Batch.Kernel ? Vmm::KernelStart : (vaddr_t)(Batch.Addresses[0])
+                , &BatchInvalidator<false>, &BatchInvalidator<true>, &info);
+        else
+            BatchInvalidator<true>(&info);
+    }
+
+    for (size_t i = 0; i < Batch.FrameCount; ++i)
+    {
+        Handle res = Pmm::AdjustReferenceCount(Batch.Frames[i], -1);
+
+#ifdef __BEELZEBUB__CONF_DEBUG
+        ASSERTX(res == HandleResult::Okay
+            || res == HandleResult::PageReserved
+            || res == HandleResult::PagesOutOfAllocatorRange)
+            (res)XEND;
+#else
+        (void)res;
+#endif
+    }
+
+    Batch.Owner = nullptr;
+    Batch.Proc = nullptr;
+    Batch.Kernel = false;
+    Batch.Count = 0;
+    Batch.FrameCount = 0;
+}
+
+static __hot __forceinline bool IsBatching()
+{
+    if unlikely(!CpuDataSetUp)
+        return false;
+
+    Thread * const thread = Cpu::GetThread();
+
+    return thread != nullptr && thread->InvalidationBatchDepth > 0;
+}
+
+/**
+ *  Prepares this core's batch to receive invalidations from the current thread,
+ *  if it has a batch open. Interrupts must be disabled.
+ */
+static __hot bool ClaimBatch()
+{
+    if (!IsBatching())
+        return false;
+
+    Thread * const thread = Cpu::GetThread();
+
+    if unlikely(Batch.Owner != thread)
+    {
+        if (Batch.Owner != nullptr)
+            FlushBatch();
+        //  Leftovers of another thread. Shouldn't happen, since batches are
+        //  flushed when their thread is switched out.
+
+        Batch.Owner = thread;
+    }
+
+    return true;
+}
+
+/**
+ *  Drops every userland translation of a process, on all the cores which may
+ *  hold any.
+ */
+static __hot void FlushUserland(Process * proc)
+{
+    BatchInvalidationInfo info { proc, false, SIZE_MAX, nullptr };
+    //  Counting past the threshold forces full flushes.
+
+    if likely(Mailbox::IsReady())
+        Shootdown(proc, Vmm::UserlandStart
+            , &BatchInvalidator<false>, &BatchInvalidator<true>, &info);
+    else
+        BatchInvalidator<true>(&info);
+}
+
+/**
+ *  Records the invalidation of the given addresses in this core's batch, if
+ *  there is one open.
+ */
+static __hot bool DeferInvalidation(Process * proc
+    , void * const * addresses, size_t count, size_t stride)
+{
+    InterruptGuard<> intGuard;
+    //  The batch belongs to this core while it is being filled.
+
+    if (!ClaimBatch())
+        return false;
+
+    if (Batch.Count > 0 && Batch.Proc != proc)
+    {
+        FlushBatch();
+        //  A batch only targets one address space.
+
+        Batch.Owner = Cpu::GetThread();
+    }
+
+    Batch.Proc = proc;
+
+    for (size_t i = 0; i < count; ++i, PTR_INC(addresses, stride))
+    {
+        void * const addr = *addresses;
+
+        if ((uintptr_t)addr >= Vmm::UserlandEnd)
+            Batch.Kernel = true;
+
+        if (Batch.Count < BatchAddressCapacity)
+            Batch.Addresses[Batch.Count] = addr;
+
+        ++Batch.Count;
+        //  Overflowing the array simply degrades into a full flush.
+    }
+
+    return true;
+}
+
+static __hot bool DeferFrameRelease(paddr_t const frame)
+{
+    InterruptGuard<> intGuard;
+
+    if (!ClaimBatch())
+        return false;
+
+    if (Batch.FrameCount == BatchFrameCapacity)
+    {
+        FlushBatch();
+
+        Batch.Owner = Cpu::GetThread();
+    }
+
+    Batch.Frames[Batch.FrameCount++] = frame;
+
+    return true;
+}
+
+void Vmm::BeginInvalidationBatch()
+{
+    if unlikely(!CpuDataSetUp)
+        return;
+
+    Thread * const thread = Cpu::GetThread();
+
+    if likely(thread != nullptr)
+        ++thread->InvalidationBatchDepth;
+    //  The depth belongs to the thread, so it follows it across cores.
+}
+
+Handle Vmm::EndInvalidationBatch()
+{
+    if unlikely(!CpuDataSetUp)
+        return HandleResult::Okay;
+
+    InterruptGuard<> intGuard;
+
+    Thread * const thread = Cpu::GetThread();
+
+    if unlikely(thread == nullptr || thread->InvalidationBatchDepth == 0)
+        return HandleResult::Okay;
+    //  Begun before the core had a thread.
+
+    if (--thread->InvalidationBatchDepth == 0 && Batch.Owner == thread)
+        FlushBatch();
+
+    return HandleResult::Okay;
+}
+
+void Vmm::FlushInvalidationBatch()
+{
+    if likely(CpuDataSetUp && Batch.Owner != nullptr)
+        FlushBatch();
+}
+
+/*  Single Invalidations  */
+
 template<bool caller>
 static __hot __solid void RangeInvalidator(void * cookie)
 {
     Vmm::RangeInvalidationInfo const * const inf = (Vmm::RangeInvalidationInfo const *)cookie;
 
-    void const * addr = inf->Addresses;
+    void * const * entry = inf->Addresses;
 
-    for (size_t i = 0; i < inf->Count; ++i, PTR_INC(addr, inf->Stride))
+    if (!caller && (uintptr_t)(*entry) < Vmm::UserlandEnd
+        && DropInactiveTranslations(inf->Proc))
+        goto end;
+
+    if (inf->Count > Vmm::FullFlushThreshold)
+        FlushTranslations(inf->Proc, (uintptr_t)(*entry) >= Vmm::UserlandEnd);
+        //  Past this many pages, refilling the TLB is cheaper than walking it.
+    else
     {
-        CpuInstructions::InvalidateTlb(addr);
+        uint64_t const pcid = GetForeignPcid(inf->Proc);
+
+        for (size_t i = 0; i < inf->Count; ++i, PTR_INC(entry, inf->Stride))
+            InvalidateAddress(*entry, pcid);
+            //  Each entry starts with the address to invalidate.
     }
 
+end:
     if (inf->After != nullptr)
         inf->After(inf, caller);
 
@@ -1177,18 +2230,18 @@ Handle Vmm::InvalidateRange(Process * proc
 {
     if unlikely(proc == nullptr) proc = likely(CpuDataSetUp) ? Cpu::GetProcess() : &BootstrapProcess;
 
-    if (broadcast && (((uintptr_t)(*addresses) >= UserlandStart && (uintptr_t)(*addresses) < UserlandEnd && proc->ActiveCoreCount == 1 && !VmmArc::PCID) || unlikely(!Mailbox::IsReady())))
+    if (broadcast && after == nullptr
+        && DeferInvalidation(proc, addresses, count, stride))
+        return HandleResult::Okay;
+
+    if unlikely(!Mailbox::IsReady())
         broadcast = false;
 
     RangeInvalidationInfo info { proc, addresses, count, stride, after, cookie };
 
     if (broadcast)
-    {
-        ALLOCATE_MAIL_BROADCAST(mail, &RangeInvalidator<false>, &info);
-        mail.SetAwait(true).Post(&RangeInvalidator<true>, &info);
-
-        //  Quite simple.
-    }
+        Shootdown(proc, (vaddr_t)(*addresses)
+            , &RangeInvalidator<false>, &RangeInvalidator<true>, &info);
     else
         RangeInvalidator<true>(&info);
 
@@ -1202,11 +2255,20 @@ static __hot void ChainInvalidator(void * cookie)
 
     Vmm::PageNode const * tmp = inf->Node;
 
-    do
+    if (!caller && tmp->Address < Vmm::UserlandEnd
+        && DropInactiveTranslations(inf->Proc))
+        goto end;
+
     {
-        CpuInstructions::InvalidateTlb(reinterpret_cast<void const *>(tmp->Address));
-    } while ((tmp = tmp->Next) != nullptr);
+        uint64_t const pcid = GetForeignPcid(inf->Proc);
+
+        do
+        {
+            InvalidateAddress(reinterpret_cast<void const *>(tmp->Address), pcid);
+        } while ((tmp = tmp->Next) != nullptr);
+    }
 
+end:
     if (inf->After != nullptr)
         inf->After(inf, caller);
 
@@ -1218,18 +2280,22 @@ Handle Vmm::InvalidateChain(Process * proc, PageNode const * node, bool broadcas
 {
     if unlikely(proc == nullptr) proc = likely(CpuDataSetUp) ? Cpu::GetProcess() : &BootstrapProcess;
 
-    if (broadcast && ((node->Address >= UserlandStart && node->Address < UserlandEnd && proc->ActiveCoreCount == 1 && !VmmArc::PCID) || unlikely(!Mailbox::IsReady())))
+    if (broadcast && after == nullptr && IsBatching())
+    {
+        for (PageNode const * tmp = node; tmp != nullptr; tmp = tmp->Next)
+            DeferInvalidation(proc, (void * const *)&(tmp->Address), 1, 0);
+
+        return HandleResult::Okay;
+    }
+
+    if unlikely(!Mailbox::IsReady())
         broadcast = false;
 
     ChainInvalidationInfo info { proc, node, after, cookie };
 
     if (broadcast)
-    {
-        ALLOCATE_MAIL_BROADCAST(mail, &ChainInvalidator<false>, &info);
-        mail.SetAwait(true).Post(&ChainInvalidator<true>, &info);
-
-        //  Quite simple.
-    }
+        Shootdown(proc, node->Address
+            , &ChainInvalidator<false>, &ChainInvalidator<true>, &info);
     else
         ChainInvalidator<true>(&info);
 
@@ -44,6 +44,7 @@
 #include <execution/runtime64.hpp>
 #include <execution/thread.hpp>
 #include <execution/thread_init.hpp>
+#include <execution/scheduler.hpp>
 #include <execution/ring_3.hpp>
 #include <memory/vmm.hpp>
 
@@ -139,11 +140,14 @@ void TestApplication()
 
     testThread.EntryPoint = &JumpToRing3;
 
-    InitializeThreadState(&testThread);
+    res = InitializeThreadState(&testThread);
     //  This sets up the thread so it goes directly to the entry point when switched to.
 
-    withInterrupts (false)
-        BootstrapThread.IntroduceNext(&testThread);
+    ASSERT(res.IsOkayResult()
+        , "Failed to initialize test userland thread: %H."
+        , res);
+
+    Scheduler::Enqueue(&testThread);
 
     // DEBUG_TERM_ << "Initialized app test main thread." << Terminals::EndLine;
 
@@ -167,11 +171,14 @@ void TestApplication()
 
     testWatcher.EntryPoint = &WatchTestThread;
 
-    InitializeThreadState(&testWatcher);
+    res = InitializeThreadState(&testWatcher);
     //  This sets up the thread so it goes directly to the entry point when switched to.
 
-    withInterrupts (false)
-        testThread.IntroduceNext(&testWatcher);
+    ASSERT(res.IsOkayResult()
+        , "Failed to initialize test watcher thread: %H."
+        , res);
+
+    Scheduler::Enqueue(&testWatcher);
 
     // DEBUG_TERM_ << "Initialized app test watcher thread." << Terminals::EndLine;
 
@@ -104,6 +104,7 @@ namespace Beelzebub { namespace System
         static acpi_table_xsdt * XsdtPointer;
         static acpi_table_madt * MadtPointer;
         static acpi_table_srat * SratPointer;
+        static acpi_table_slit * SlitPointer;
 
 #if   defined(__BEELZEBUB_SETTINGS_SMP)
         static size_t LapicCount;
@@ -142,6 +143,7 @@ namespace Beelzebub { namespace System
 
         static __startup Handle HandleMadt(paddr_t const paddr, SystemDescriptorTableSource const src);
         static __startup Handle HandleSrat(paddr_t const paddr, SystemDescriptorTableSource const src);
+        static __startup Handle HandleSlit(paddr_t const paddr, SystemDescriptorTableSource const src);
 
         /*  Utilities  */
 
@@ -46,8 +46,11 @@
 #include "system/msrs.hpp"
 
 #include "execution/thread.hpp"
+#include "execution/scheduler.hpp"
 
 #include "mailbox.hpp"
+#include "timer.hpp"
+#include "memory/object_allocator_smp.hpp"
 
 #include <beel/sync/atomic.hpp>
 #include <beel/sync/smp.lock.hpp>
@@ -120,6 +123,7 @@ namespace Beelzebub { namespace System
     struct CpuData : public CpuDataBase
     {
         Domain * DomainDescriptor = nullptr;
+        uint32_t NumaNode = 0;
         Tss EmbeddedTss;
 
         uint16_t GdtLength;
@@ -127,6 +131,9 @@ namespace Beelzebub { namespace System
 
         Execution::Thread * LastExtendedStateThread = nullptr;
 
+        Execution::RunQueue RunQueue;
+        TimerWheel Timers;
+
 #if defined(__BEELZEBUB_SETTINGS_SMP)
         MailboxEntryBase * MailHead = nullptr, * MailTail = nullptr;
         Synchronization::SmpLock MailLock {};
@@ -136,6 +143,8 @@ namespace Beelzebub { namespace System
 #endif
 
         Synchronization::Atomic<MailboxEntryBase *> MailNmTop { nullptr };
+
+        Memory::ObjectMagazine ObjaMagazines[Memory::ObjectMagazineSlots];
 #endif
     };
 
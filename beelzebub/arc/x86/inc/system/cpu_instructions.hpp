@@ -86,6 +86,63 @@ namespace Beelzebub { namespace System
             asm volatile ( "invlpg %0 \n\t" : : "m"(*p) );
         }
 
+#if   defined(__BEELZEBUB__ARCH_AMD64)
+        static __artificial void InvalidateTlb(void const * const addr, uint64_t const pcid)
+        {
+            InvalidatePcid(0, pcid, addr);
+        }
+
+        static __artificial void InvalidateTlbContext(uint64_t const pcid)
+        {
+            InvalidatePcid(1, pcid, nullptr);
+        }
+
+        static __artificial void InvalidateTlbAllContexts()
+        {
+            InvalidatePcid(3, 0, nullptr);
+            //  Global translations are kept.
+        }
+
+        static __artificial void InvalidateTlbEverything()
+        {
+            InvalidatePcid(2, 0, nullptr);
+        }
+
+        static __artificial void InvalidatePcid(uint64_t const type
+            , uint64_t const pcid, void const * const addr)
+        {
+            struct { uint64_t Pcid; uint64_t Address; } const desc
+            = { pcid, reinterpret_cast<uint64_t>(addr) };
+
+            asm volatile ( "invpcid %[desc], %[type] \n\t"
+                         :
+                         : [desc]"m"(desc), [type]"r"(type)
+                         : "memory" );
+        }
+#endif
+
+#if   defined(__BEELZEBUB__ARCH_AMD64)
+        static __artificial void ZeroNonTemporal(void * const addr, size_t const size)
+        {
+            //  Bypasses the caches, so memory which is not read soon does not
+            //  evict anything. The size must be a multiple of 32 bytes.
+
+            for (uint64_t * p = reinterpret_cast<uint64_t *>(addr), * const end = p + size / 8
+                ; p < end
+                ; p += 4)
+                asm volatile ( "movnti %[zero],  0(%[p]) \n\t"
+                               "movnti %[zero],  8(%[p]) \n\t"
+                               "movnti %[zero], 16(%[p]) \n\t"
+                               "movnti %[zero], 24(%[p]) \n\t"
+                             :
+                             : [p]"r"(p), [zero]"r"((uint64_t)0)
+                             : "memory" );
+
+            asm volatile ( "sfence \n\t" : : : "memory" );
+            //  Makes the zeros visible before the memory is handed out.
+        }
+#endif
+
         static __artificial void FlushCache(void const * const addr)
         {
             struct _64_bytes { uint8_t x[64]; } const * const p
@@ -190,7 +190,8 @@ namespace Beelzebub { namespace System
 
         /*  Statics  */
 
-        static bool Available, Sse, Avx, Xsave;
+        static bool Available, Sse, Avx, Xsave, Xsaveopt, Xsavec;
+        static bool Eager;
         static size_t StateSize, StateAlignment;
 
         static XsaveRfbm Xcr0;
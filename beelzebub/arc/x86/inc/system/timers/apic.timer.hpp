@@ -39,7 +39,8 @@
 
 #pragma once
 
-#include <beel/metaprogramming.h>
+#include <system/lapic_registers.hpp>
+#include <system/msrs.hpp>
 
 namespace Beelzebub { namespace System { namespace Timers
 {
@@ -55,6 +56,10 @@ namespace Beelzebub { namespace System { namespace Timers
         static size_t TicksPerMicrosecond;
         static uint32_t Divisor;
 
+        static bool TscDeadline;
+        static uint64_t TscFrequency;
+        static size_t TscTicksPerMicrosecond;
+
     protected:
         /*  Constructor(s)  */
 
@@ -72,15 +77,31 @@ namespace Beelzebub { namespace System { namespace Timers
 
         static inline void OneShot(uint32_t ticks, uint8_t interrupt, bool mask = true)
         {
-            return SetInternal(ticks, interrupt, false, mask);
+            return SetInternal(ticks, interrupt, ApicTimerMode::OneShot, mask);
+        }
+
+        static inline void Deadline(uint8_t interrupt, bool mask = true)
+        {
+            return SetInternal(0, interrupt, ApicTimerMode::TscDeadline, mask);
         }
         
         static void SetCount(uint32_t count);
         static uint32_t GetCount();
 
+        static __forceinline void SetDeadline(uint64_t tsc)
+        {
+            Msrs::Write(Msr::IA32_TSC_DEADLINE, tsc);
+        }
+
+        static __forceinline uint64_t GetDeadline()
+        {
+            return Msrs::Read64(Msr::IA32_TSC_DEADLINE);
+            //  Becomes zero when the timer fires.
+        }
+
         static void Stop();
 
     private:
-        static void SetInternal(uint32_t count, uint8_t interrupt, bool periodic, bool mask = true);
+        static void SetInternal(uint32_t count, uint8_t interrupt, ApicTimerMode mode, bool mask = true);
     };
 }}}
@@ -0,0 +1,104 @@
+/*
+    Copyright (c) 2017 Alexandru-Mihai Maftei. All rights reserved.
+
+
+    Developed by: Alexandru-Mihai Maftei
+    aka Vercas
+    http://vercas.com | https://github.com/vercas/Beelzebub
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal with the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+      * Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimers.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimers in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the names of Alexandru-Mihai Maftei, Vercas, nor the names of
+        its contributors may be used to endorse or promote products derived from
+        this Software without specific prior written permission.
+
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    WITH THE SOFTWARE.
+
+    ---
+
+    You may also find the text of this license in "LICENSE.md", along with a more
+    thorough explanation regarding other files.
+*/
+
+#pragma once
+
+#include <system/cpu_instructions.hpp>
+
+namespace Beelzebub { namespace System { namespace Timers
+{
+    /**
+     *  <summary>Contains methods for using the time-stamp counter as a clock.</summary>
+     */
+    class Tsc
+    {
+    public:
+        /*  Statics  */
+
+        static uint64_t Frequency;
+        static bool Invariant;
+        static bool Synchronized;
+        //  Whether no core was seen going back in time relative to another.
+
+        static uint64_t Offset;
+        //  The counter's value at calibration.
+        static uint64_t Multiplier;
+        static constexpr unsigned int const Shift = 32;
+        //  Nanoseconds are (ticks * Multiplier) >> Shift.
+
+    protected:
+        /*  Constructor(s)  */
+
+        Tsc() = default;
+
+    public:
+        Tsc(Tsc const &) = delete;
+        Tsc & operator =(Tsc const &) = delete;
+
+        /*  Initialization  */
+
+        static __cold void Initialize();
+        static __cold void CheckSynchronization(bool bsp);
+
+        /*  Properties  */
+
+        static __forceinline bool IsReliable()
+        {
+            return Invariant && Synchronized;
+        }
+
+        static __forceinline uint64_t GetNanoseconds()
+        {
+            uint64_t const ticks = CpuInstructions::Rdtsc() - Offset;
+
+#if   defined(__BEELZEBUB__ARCH_AMD64)
+            return (uint64_t)(((unsigned __int128)ticks * Multiplier) >> Shift);
+#else
+            static_assert(Shift == 32, "The product below is split at the shift.");
+
+            uint64_t const lo = ticks & 0xFFFFFFFFU, hi = ticks >> 32;
+
+            return hi * Multiplier + lo * (Multiplier >> 32)
+                + ((lo * (Multiplier & 0xFFFFFFFFU)) >> 32);
+            //  The same product, in 32-bit halves. There are no 128-bit
+            //  integers on ia32.
+#endif
+        }
+    };
+}}}
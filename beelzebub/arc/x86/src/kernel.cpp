@@ -53,6 +53,7 @@
 #include "system/cpu.hpp"
 #include "system/fpu.hpp"
 #include "execution/thread_init.hpp"
+#include "execution/scheduler.hpp"
 #include "execution/extended_states.hpp"
 #include "execution/runtime64.hpp"
 
@@ -67,12 +68,14 @@
 #include "system/syscalls.hpp"
 #include "system/timers/pit.hpp"
 #include "system/timers/apic.timer.hpp"
+#include "system/timers/tsc.hpp"
 
 #ifdef __BEELZEBUB_SETTINGS_KRNDYNALLOC_JEMALLOC
 #include <beel/jemalloc.h>
 #endif
 
 #include "memory/vmm.arc.hpp"
+#include "memory/pmm.arc.hpp"
 
 #include "ap_bootstrap.hpp"
 
@@ -243,6 +246,29 @@ static __startup void MainInitializeVirtualMemory()
     }
 }
 
+static __startup void MainInitializeMemoryAffinity()
+{
+    //  Assign the memory and the cores to NUMA nodes, as described by the SRAT.
+    //  Without one, memory is uniform.
+
+    if (Acpi::SratPointer == nullptr)
+    {
+        MainTerminal->WriteLine("[SKIP] No SRAT found; memory is treated as uniform.");
+
+        return;
+    }
+
+    MainTerminal->Write("[....] Reading memory affinity...");
+    Handle res = PmmArc::ApplyAffinity();
+
+    if (res.IsOkayResult())
+        MainTerminal->WriteFormat(" %us node%s. Done.\r[OKAY]%n"
+            , PmmArc::NodeCount, PmmArc::NodeCount != 1 ? "s" : "");
+    else
+        MainTerminal->WriteFormat(" Fail..? %H\r[FAIL]%n", res);
+    //  Not fatal; allocation ignores nodes.
+}
+
 static __startup void MainInitializeCores()
 {
     //  Initialize the manager of processing cores.
@@ -349,8 +375,14 @@ static __startup void MainBootstrapThread()
         FAIL("Failed to initialize main entry point as bootstrap thread: %H", res);
     }
 
+    BootstrapThread.Pinned = true;
+    //  It becomes the BSP's idle thread, so it must not leave the BSP.
+
     Cpu::SetThread(&BootstrapThread);
     Cpu::SetProcess(&BootstrapProcess);
+
+    Scheduler::Initialize();
+    //  The BSP's scheduler needs the thread in place.
 }
 
 static __startup void MainInitializeExtraCpus()
@@ -507,7 +539,8 @@ static __startup void MainInitializeFpu()
             res = ExtendedStates::AllocateTemplate(templateState);
 
             if (res.IsOkayResult())
-                MainTerminal->WriteLine(" Done.\r[OKAY]");
+                MainTerminal->WriteFormat(" Done; %us bytes%s.\r[OKAY]%n"
+                    , Fpu::StateSize, Fpu::Eager ? ", eager" : "");
             else
             {
                 MainTerminal->WriteLine("\r[FAIL]%n");
@@ -518,7 +551,19 @@ static __startup void MainInitializeFpu()
 
             Fpu::SaveState(templateState);
 
-            Cpu::SetCr0(Cpu::GetCr0().SetTaskSwitched(true));
+            if (Fpu::Eager)
+            {
+                res = ExtendedStates::AllocateNew(BootstrapThread.ExtendedState);
+
+                ASSERT(res.IsOkayResult()
+                    , "Failed to allocate the bootstrap thread's extended state: %H"
+                    , res);
+                //  It predates the FPU setup, unlike other threads.
+            }
+            else
+                Cpu::SetCr0(Cpu::GetCr0().SetTaskSwitched(true));
+            //  In eager mode, states are switched along with threads, so the
+            //  FPU never needs to trap.
         }
         else
         {
@@ -618,6 +663,7 @@ void Beelzebub::Main()
     MainInitializePhysicalMemory();
     MainInitializeAcpiTables();
     MainInitializeVirtualMemory();
+    MainInitializeMemoryAffinity();
     MainInitializeBootModules();
     MainInitializeCores();
 
@@ -680,6 +726,11 @@ void Beelzebub::Main()
         MallocTestBarrier.Reset(Cores::GetCount());
 #endif
 
+#ifdef __BEELZEBUB__TEST_SCHED
+    if (CHECK_TEST(SCHED))
+        SchedulerTestBarrier.Reset(Cores::GetCount());
+#endif
+
     MainInitializeExtraCpus();
     // MainElideLocks();
 
@@ -700,6 +751,14 @@ void Beelzebub::Main()
 
     InitBarrier.Reach();
 
+    Tsc::CheckSynchronization(true);
+    //  All cores are running now, so their counters can be compared.
+
+#if defined(__BEELZEBUB__ARCH_AMD64)
+    Runtime64::UpdateSharedData();
+    //  Userland may now use the TSC, if it is reliable.
+#endif
+
     Scheduling = true;
 
     Interrupts::Enable();
@@ -940,8 +999,21 @@ void Beelzebub::Main()
     }
 #endif
 
-    //  Allow the CPU to rest.
-    while (true) if (CpuInstructions::CanHalt) CpuInstructions::Halt();
+#ifdef __BEELZEBUB__TEST_SCHED
+    if (CHECK_TEST(SCHED))
+    {
+        withLock (TerminalMessageLock)
+            MainTerminal->WriteFormat("Core %us: Benchmarking context switches.%n", Cpu::GetData()->Index);
+
+        TestScheduler(true);
+
+        withLock (TerminalMessageLock)
+            MainTerminal->WriteFormat("Core %us: Finished scheduler test.%n", Cpu::GetData()->Index);
+    }
+#endif
+
+    //  Allow the CPU to rest, or run whatever else needs running.
+    Scheduler::Idle();
 }
 
 #if   defined(__BEELZEBUB_SETTINGS_SMP)
@@ -990,7 +1062,8 @@ void Beelzebub::Secondary()
 
     ApicTimer::Initialize(false);
     Timer::Initialize();
-    //  And timers.
+    Scheduler::Initialize();
+    //  And timers, with the scheduler's tick.
 
     MSG_("Initialized timers... %W");
 
@@ -1019,6 +1092,8 @@ void Beelzebub::Secondary()
 
     InitBarrier.Reach();
 
+    Tsc::CheckSynchronization(false);
+
 #ifdef __BEELZEBUB__TEST_STACKINT
     if (CHECK_TEST(STACKINT))
     {
@@ -1123,8 +1198,21 @@ void Beelzebub::Secondary()
     }
 #endif
 
-    //  Allow the CPU to rest.
-    while (true) if (CpuInstructions::CanHalt) CpuInstructions::Halt();
+#ifdef __BEELZEBUB__TEST_SCHED
+    if (CHECK_TEST(SCHED))
+    {
+        withLock (TerminalMessageLock)
+            MainTerminal->WriteFormat("Core %us: Benchmarking context switches.%n", Cpu::GetData()->Index);
+
+        TestScheduler(false);
+
+        withLock (TerminalMessageLock)
+            MainTerminal->WriteFormat("Core %us: Finished scheduler test.%n", Cpu::GetData()->Index);
+    }
+#endif
+
+    //  Allow the CPU to rest, or run whatever else needs running.
+    Scheduler::Idle();
 }
 #endif
 
@@ -1389,6 +1477,9 @@ Handle InitializeTimers()
 
     MainTerminal->WriteFormat(" APIC @ %u8 Hz...", ApicTimer::Frequency);
 
+    if (ApicTimer::TscDeadline)
+        MainTerminal->WriteFormat(" TSC-deadline @ %u8 Hz...", ApicTimer::TscFrequency);
+
     Pit::SetHandler();
 
     Pit::SetFrequency(1000);
@@ -1397,6 +1488,11 @@ Handle InitializeTimers()
 
     MainTerminal->WriteFormat(" PIT @ %u4 Hz...", Pit::Frequency);
 
+    Tsc::Initialize();
+
+    MainTerminal->WriteFormat(" TSC @ %u8 Hz%s...", Tsc::Frequency
+        , Tsc::Invariant ? " (invariant)" : "");
+
     Timer::Initialize();
 
     return HandleResult::Okay;
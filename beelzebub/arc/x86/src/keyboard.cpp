@@ -39,7 +39,7 @@
 
 #include <keyboard.hpp>
 
-#include <system/cpu.hpp>   //  Only used for task switching right now...
+#include <execution/scheduler.hpp>
 #include <system/io_ports.hpp>
 #include <system/timers/pit.hpp>
 
@@ -115,26 +115,8 @@ void keyboard_handler(INTERRUPT_HANDLER_ARGS_FULL)
             break;
 
         case KEYBOARD_CODE_UP:
-            Thread * const activeThread = Cpu::GetThread();
-
-            if (activeThread != nullptr)
-            {
-                activeThread->State = *state;
-
-                //msg("PRE-SWITCH ");
-                //PrintToDebugTerminal(state);
-                //msg("%n");
-
-                /*msg("(( AT=%Xp; N=%Xp; P=%Xp; BST=%B ))%n"
-                    , activeThread, activeThread->Next, activeThread->Previous
-                    , activeThread == &BootstrapThread);//*/
-
-                activeThread->SwitchToNext(state);
-
-                //msg("%nPOST-SWITCH ");
-                //PrintToDebugTerminal(state);
-                //msg("%n");
-            }
+            Scheduler::Schedule(state);
+            //  Forces a switch to the next thread, if any.
 
             break;
 
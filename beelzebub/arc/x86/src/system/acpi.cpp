@@ -61,6 +61,9 @@ SystemDescriptorTableSource MadtSrc   = SystemDescriptorTableSource::None;
 paddr_t                     SratPaddr = nullpaddr;
 SystemDescriptorTableSource SratSrc   = SystemDescriptorTableSource::None;
 
+paddr_t                     SlitPaddr = nullpaddr;
+SystemDescriptorTableSource SlitSrc   = SystemDescriptorTableSource::None;
+
 /*****************
     ACPI class
 *****************/
@@ -72,6 +75,7 @@ acpi_table_rsdt * Acpi::RsdtPointer = nullptr;
 acpi_table_xsdt * Acpi::XsdtPointer = nullptr;
 acpi_table_madt * Acpi::MadtPointer = nullptr;
 acpi_table_srat * Acpi::SratPointer = nullptr;
+acpi_table_slit * Acpi::SlitPointer = nullptr;
 
 size_t Acpi::LapicCount = 0;
 size_t Acpi::PresentLapicCount = 0;
@@ -169,7 +173,12 @@ Handle Acpi::Remap()
     REMAP(RsdtPointer)
     REMAP(XsdtPointer)
     REMAP(MadtPointer)
-    REMAP(SratPointer)
+
+    if (SratPointer != nullptr)
+        REMAP(SratPointer)
+    if (SlitPointer != nullptr)
+        REMAP(SlitPointer)
+    //  These are optional, and null has to stay null.
 
     #undef REMAP
 
@@ -414,6 +423,8 @@ Handle Acpi::HandleSystemDescriptorTable(paddr_t const paddr, SystemDescriptorTa
         return Acpi::HandleMadt(paddr, src);
     else if (memeq(headerPtr->Signature, ACPI_SIG_SRAT, ACPI_NAME_SIZE))
         return Acpi::HandleSrat(paddr, src);
+    else if (memeq(headerPtr->Signature, ACPI_SIG_SLIT, ACPI_NAME_SIZE))
+        return Acpi::HandleSlit(paddr, src);
     // else
     //     MSG("$ Found unknown ACPI table: %S%n", ACPI_NAME_SIZE, headerPtr->Signature);
 
@@ -504,6 +515,29 @@ Handle Acpi::HandleSrat(paddr_t const paddr, SystemDescriptorTableSource const s
     return HandleResult::Okay;
 }
 
+Handle Acpi::HandleSlit(paddr_t const paddr, SystemDescriptorTableSource const src)
+{
+    if (SlitPaddr == paddr || (SlitSrc != src && SlitSrc != SystemDescriptorTableSource::None))
+        return HandleResult::Okay;
+    //  Same physical address or different source table? No problemo, then.
+
+    assert_or(SlitPointer == nullptr
+        , "Duplicate (different) SLITs found under the same table (%s)?!%n"
+          "First @ %Xp (%XP);%n"
+          "Second @ %XP."
+        , (src == SystemDescriptorTableSource::Xsdt) ? ACPI_SIG_XSDT : ACPI_SIG_RSDT
+        , SlitPointer, SlitPaddr, paddr)
+    {
+        return HandleResult::CardinalityViolation;
+    }
+
+    SlitPointer = (acpi_table_slit *)(uintptr_t)paddr;
+    SlitPaddr = paddr;
+    SlitSrc = src;
+
+    return HandleResult::Okay;
+}
+
 /*  Utilities  */
 
 Handle Acpi::FindLapicPaddr(paddr_t & paddr)
@@ -63,6 +63,9 @@ bool Fpu::Available = false;
 bool Fpu::Sse = false;
 bool Fpu::Avx = false;
 bool Fpu::Xsave = false;
+bool Fpu::Xsaveopt = false;
+bool Fpu::Xsavec = false;
+bool Fpu::Eager = false;
 
 size_t Fpu::StateSize = 0;
 size_t Fpu::StateAlignment = 0;
@@ -101,6 +104,19 @@ void Fpu::InitializeMain()
         if (!Fpu::Avx)
             Fpu::Xsave = false;
         //  Disable XSAVE usage... It's unnecessary.
+
+        if (Fpu::Xsave)
+        {
+            uint32_t w, x, y, z;
+            CpuId::Execute(0xDU, 1U, w, x, y, z);
+
+            Fpu::Xsaveopt = (w & (1U << 0)) != 0;
+            Fpu::Xsavec = (w & (1U << 1)) != 0;
+        }
+
+        Fpu::Eager = Fpu::Xsaveopt || Fpu::Xsavec;
+        //  With the optimized instructions, saving and restoring unused or
+        //  unmodified components is cheap enough to do on every switch.
     }
     else
     {
@@ -108,11 +124,27 @@ void Fpu::InitializeMain()
         Fpu::StateAlignment = 0;
     }
 
-    // msg("** FPU%b SSE%b AVX%b XSAVE%b; SS=%us SA=%us **%n"
-    //     , Fpu::Available, Fpu::Sse, Fpu::Avx, Fpu::Xsave
-    //     , Fpu::StateSize, Fpu::StateAlignment);
-
     Fpu::InitializeSecondary();
+
+    if (Fpu::Xsavec)
+    {
+        uint32_t w, x, y, z;
+        CpuId::Execute(0xDU, 1U, w, x, y, z);
+        //  EBX is the size of the compacted area for the components enabled in
+        //  XCR0, which is only known after it's written.
+
+        ASSERT(x >= sizeof(FxsaveMap) + sizeof(XsaveHeader)
+            , "Compacted XSAVE area size (%u4) is smaller than the legacy area"
+              " and header."
+            , x);
+
+        if (x < Fpu::StateSize)
+            Fpu::StateSize = x;
+    }
+
+    // msg("** FPU%b SSE%b AVX%b XSAVE%b XSAVEOPT%b XSAVEC%b; SS=%us SA=%us **%n"
+    //     , Fpu::Available, Fpu::Sse, Fpu::Avx, Fpu::Xsave, Fpu::Xsaveopt
+    //     , Fpu::Xsavec, Fpu::StateSize, Fpu::StateAlignment);
 }
 
     void Fpu::InitializeSecondary()
@@ -136,7 +168,21 @@ void Fpu::InitializeMain()
 
 void Fpu::SaveState(void * state)
 {
-    if (Fpu::Xsave)
+    if (Fpu::Xsavec)
+    {
+        asm volatile (  "xsavec" SAVE_SUFFIX " %[ptr] \n\t"
+                     :
+                     : [ptr]"m"(*((char *)state))
+                     , "a"(Fpu::Xcr0.Low), "d"(Fpu::Xcr0.High) );
+    }
+    else if (Fpu::Xsaveopt)
+    {
+        asm volatile (  "xsaveopt" SAVE_SUFFIX " %[ptr] \n\t"
+                     :
+                     : [ptr]"m"(*((char *)state))
+                     , "a"(Fpu::Xcr0.Low), "d"(Fpu::Xcr0.High) );
+    }
+    else if (Fpu::Xsave)
     {
         asm volatile (  "xsave" SAVE_SUFFIX " %[ptr] \n\t"
                      :
@@ -155,6 +201,7 @@ void Fpu::LoadState(void * state)
                      :
                      : [ptr]"m"(*((char *)state))
                      , "a"(Fpu::Xcr0.Low), "d"(Fpu::Xcr0.High) );
+        //  XRSTOR recognizes the compacted format by itself.
     }
     else
         asm volatile ( "fxrstor" SAVE_SUFFIX " %[ptr] \n\t" : : [ptr]"m"(*((char *)state)) );
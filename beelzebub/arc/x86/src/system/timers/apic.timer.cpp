@@ -40,6 +40,8 @@
 #include "system/timers/apic.timer.hpp"
 #include "system/timers/pit.hpp"
 #include "system/interrupt_controllers/lapic.hpp"
+#include "system/cpu_instructions.hpp"
+#include <entry.h>
 #include <beel/sync/atomic.hpp>
 
 #include <debug.hpp>
@@ -62,6 +64,7 @@ static int Stage = 0;
 static constexpr int const StageCount = 100;
 static Atomic<CalibrationStatus> Status;
 static size_t FirstCounter, AverageCounter;
+static uint64_t FirstTsc, AverageTsc;
 
 static __cold void PitTickIrqHandler(INTERRUPT_HANDLER_ARGS_FULL)
 {
@@ -70,16 +73,21 @@ static __cold void PitTickIrqHandler(INTERRUPT_HANDLER_ARGS_FULL)
     if likely(Stage < StageCount)
     {
         if unlikely(Stage == 0)
+        {
             FirstCounter = Lapic::ReadRegister(LapicRegister::TimerCurrentCount);
+            FirstTsc = CpuInstructions::Rdtsc();
+        }
 
         ++Stage;
     }
     else
     {
         size_t current = Lapic::ReadRegister(LapicRegister::TimerCurrentCount);
+        uint64_t currentTsc = CpuInstructions::Rdtsc();
 
         //  Turn the accumulated counters into a proper average.
         AverageCounter = (FirstCounter - current) / StageCount;
+        AverageTsc = (currentTsc - FirstTsc) / StageCount;
 
         //  If calibration hasn't failed by the last stage, then it has succeeded.
         CalibrationStatus st = Ongoing;
@@ -134,6 +142,10 @@ uint64_t ApicTimer::Frequency;
 size_t ApicTimer::TicksPerMicrosecond;
 uint32_t ApicTimer::Divisor;
 
+bool ApicTimer::TscDeadline = false;
+uint64_t ApicTimer::TscFrequency;
+size_t ApicTimer::TscTicksPerMicrosecond;
+
 /*  Initialization  */
 
 void ApicTimer::Initialize(bool bsp)
@@ -183,7 +195,7 @@ void ApicTimer::Initialize(bool bsp)
     {
         Lapic::WriteRegister(LapicRegister::TimerDivisor, TranslateDivisor(divisor));
 
-        ApicTimer::SetInternal(0xFFFFFFFF, vec.GetVector(), false);
+        ApicTimer::SetInternal(0xFFFFFFFF, vec.GetVector(), ApicTimerMode::OneShot, false);
 
         Stage = 0;
         Status = Ongoing;
@@ -219,6 +231,15 @@ void ApicTimer::Initialize(bool bsp)
     Frequency = absFreq;
     TicksPerMicrosecond = (freq + (400000 / divisor)) / 1000000;
     Divisor = divisor;
+
+    TscFrequency = AverageTsc * PitFrequency;
+    TscTicksPerMicrosecond = (TscFrequency + 500000) / 1000000;
+    //  The TSC was sampled alongside the APIC timer during calibration.
+
+    TscDeadline = BootstrapCpuid.CheckFeature(CpuFeature::TscDeadline)
+               && TscTicksPerMicrosecond > 0;
+    //  Deadlines are absolute, so they need neither re-adjustment nor fit in
+    //  32 bits.
 }
 
 /*  Operation  */
@@ -238,14 +259,22 @@ void ApicTimer::Stop()
     Lapic::WriteRegister(LapicRegister::TimerInitialCount, 0);
 }
 
-void ApicTimer::SetInternal(uint32_t count, uint8_t interrupt, bool periodic, bool mask)
+void ApicTimer::SetInternal(uint32_t count, uint8_t interrupt, ApicTimerMode mode, bool mask)
 {
     Lapic::WriteRegister(LapicRegister::TimerLvt,
         ApicTimerLvt(0)
         .SetVector(interrupt)
-        .SetMode(periodic ? ApicTimerMode::Periodic : ApicTimerMode::OneShot)
+        .SetMode(mode)
         .SetMask(mask)
         .Value);
 
-    Lapic::WriteRegister(LapicRegister::TimerInitialCount, count);
+    if (mode == ApicTimerMode::TscDeadline)
+    {
+        asm volatile ( "mfence \n\t" : : : "memory" );
+        //  The LVT write must be visible before the deadline MSR is written.
+
+        SetDeadline(0);
+    }
+    else
+        Lapic::WriteRegister(LapicRegister::TimerInitialCount, count);
 }
@@ -40,14 +40,11 @@
 #include <system/timers/pit.hpp>
 #include <system/interrupt_controllers/pic.hpp>
 #include <system/io_ports.hpp>
-#include <system/cpu.hpp>   //  Only used for task switching right now...
-#include <kernel.hpp>
     
 #include <debug.hpp>
 #include <_print/isr.hpp>
 
 using namespace Beelzebub;
-using namespace Beelzebub::Execution;
 using namespace Beelzebub::System::InterruptControllers;
 using namespace Beelzebub::Synchronization;
 using namespace Beelzebub::System;
@@ -101,34 +98,9 @@ uint32_t Pit::Frequency {0};
 
 void Pit::IrqHandler(INTERRUPT_HANDLER_ARGS_FULL)
 {
-    ++Counter;
-
-    if (CpuDataSetUp && Scheduling)
-    {
-        Thread * const activeThread = Cpu::GetThread();
-
-        if (activeThread != nullptr && activeThread->Next != activeThread)
-        {
-            activeThread->State = *state;
-
-            // if (activeThread == &BootstrapThread)
-            //     msg("(( RIP = %Xp ))", state->RIP);
+    (void)state;
 
-            // msg("PRE-SWITCH ");
-            // PrintToDebugTerminal(state);
-            // msg("%n");
-
-            // msg("(( AT=%Xp; N=%Xp; P=%Xp; BST=%B ))%n"
-            //     , activeThread, activeThread->Next, activeThread->Previous
-            //     , activeThread == &BootstrapThread);
-
-            activeThread->SwitchToNext(state);
-
-            // msg("%nPOST-SWITCH ");
-            // PrintToDebugTerminal(state);
-            // msg("%n");
-        }
-    }
+    ++Counter;
 
     END_OF_INTERRUPT();
 }
@@ -0,0 +1,156 @@
+/*
+    Copyright (c) 2017 Alexandru-Mihai Maftei. All rights reserved.
+
+
+    Developed by: Alexandru-Mihai Maftei
+    aka Vercas
+    http://vercas.com | https://github.com/vercas/Beelzebub
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal with the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+      * Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimers.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimers in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the names of Alexandru-Mihai Maftei, Vercas, nor the names of
+        its contributors may be used to endorse or promote products derived from
+        this Software without specific prior written permission.
+
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    WITH THE SOFTWARE.
+
+    ---
+
+    You may also find the text of this license in "LICENSE.md", along with a more
+    thorough explanation regarding other files.
+*/
+
+#include "system/timers/tsc.hpp"
+#include "system/timers/pit.hpp"
+#include "system/cpuid.hpp"
+#include "system/interrupts.hpp"
+#include "cores.hpp"
+#include <beel/sync/smp.lock.hpp>
+#include <beel/sync/barrier.hpp>
+
+#include <debug.hpp>
+
+using namespace Beelzebub;
+using namespace Beelzebub::Synchronization;
+using namespace Beelzebub::System;
+using namespace Beelzebub::System::Timers;
+
+/******************
+    Calibration
+******************/
+
+static constexpr size_t const CalibrationMilliseconds = 50;
+static constexpr size_t const WarpIterations = 100000;
+
+static Barrier WarpBarrier;
+static SmpLock WarpLock {};
+static uint64_t WarpLast = 0, WarpMax = 0;
+
+static __cold size_t WaitForPitTick()
+{
+    size_t const start = Pit::Counter.Load();
+    size_t current;
+
+    do
+    {
+        current = Pit::Counter.Load();
+    } while (current == start);
+
+    return current;
+}
+
+/****************
+    Tsc class
+****************/
+
+/*  Statics  */
+
+uint64_t Tsc::Frequency = 0;
+bool Tsc::Invariant = false;
+bool Tsc::Synchronized = false;
+uint64_t Tsc::Offset = 0;
+uint64_t Tsc::Multiplier = 0;
+
+/*  Initialization  */
+
+void Tsc::Initialize()
+{
+    uint32_t a, b, c, d;
+
+    CpuId::Execute(0x80000000U, a, b, c, d);
+
+    if (a >= 0x80000007U)
+    {
+        CpuId::Execute(0x80000007U, a, b, c, d);
+
+        Invariant = 0 != (d & (1U << 8));
+    }
+
+    //  The PIT ticks every millisecond, so a few of them are counted. Starting
+    //  and ending on an edge removes the phase error.
+
+    uint64_t start, end;
+
+    withInterrupts (true)
+    {
+        size_t const first = WaitForPitTick();
+        start = CpuInstructions::Rdtsc();
+
+        while (Pit::Counter.Load() - first < CalibrationMilliseconds) { }
+
+        end = CpuInstructions::Rdtsc();
+    }
+
+    Frequency = (end - start) * (1000 / CalibrationMilliseconds);
+    Multiplier = (1000000000ULL << Shift) / Frequency;
+    //  Fits in 64 bits, so no wide division is needed.
+    Offset = start;
+
+    WarpBarrier.Reset(Cores::GetCount());
+}
+
+void Tsc::CheckSynchronization(bool bsp)
+{
+    //  Every core reads its counter under a lock and compares it to the last
+    //  value read by any core. A smaller value means the counters are skewed.
+
+    WarpBarrier.Reach();
+
+    for (size_t i = 0; i < WarpIterations; ++i)
+        withLock (WarpLock)
+        {
+            uint64_t const now = CpuInstructions::Rdtsc();
+
+            if unlikely(now < WarpLast && WarpLast - now > WarpMax)
+                WarpMax = WarpLast - now;
+
+            WarpLast = now;
+        }
+
+    WarpBarrier.Reach();
+
+    if (bsp)
+    {
+        Synchronized = WarpMax == 0;
+
+        if (!Synchronized)
+            MSG_("TSC warp of %u8 ticks detected across cores.%n", WarpMax);
+    }
+}
@@ -42,10 +42,16 @@
 #include "system/interrupt_controllers/lapic.hpp"
 #include "system/cpu.hpp"
 #include "kernel.hpp"
+#include "execution/scheduler.hpp"
+#include "memory/object_allocator_smp.hpp"
+#include "memory/object_allocator_pools_heap.hpp"
 #include <beel/sync/smp.lock.hpp>
+#include <beel/sync/atomic.hpp>
 #include <string.h>
 
 using namespace Beelzebub;
+using namespace Beelzebub::Execution;
+using namespace Beelzebub::Memory;
 using namespace Beelzebub::Synchronization;
 using namespace Beelzebub::System;
 using namespace Beelzebub::System::InterruptControllers;
@@ -55,44 +61,297 @@ using namespace Beelzebub::System::Timers;
     Internals
 ****************/
 
-static __thread uint_fast16_t MyTimersCount = 0;
-static __thread TimerEntry MyTimers[Timer::Count];
+static ObjectAllocatorSmp EntryAllocator;
+static Atomic<uint64_t> NextSequence {1};
 
-static __hot void TimerIrqHandler(INTERRUPT_HANDLER_ARGS_FULL)
+static uint64_t TickLength;
+//  APIC timer (or TSC, in deadline mode) ticks per wheel tick.
+static size_t WheelTicksPerMicrosecond;
+//  Ticks of the same clock per microsecond.
+
+static constexpr uint64_t const WheelSpan = 1ULL << (TimerWheel::LevelBits * TimerWheel::LevelCount);
+//  Timers further than this are parked in the last slot of the top level.
+
+static void Link(TimerWheel & wheel, TimerEntry * const entry)
 {
-    auto timersCount = MyTimersCount;
+    uint64_t expiry = entry->Expiry;
+    unsigned int level = 0;
 
-    if likely(timersCount > 0)
+    if unlikely((int64_t)(expiry - wheel.Now) < 0)
+        expiry = wheel.Now;
+    //  Overdue timers go in the slot which is processed next.
+    else
     {
-        TimerEntry const entry = MyTimers[0];
+        uint64_t const delta = expiry - wheel.Now;
 
-        MyTimersCount = --timersCount;
-        //  First timer is popped.
+        while (level < TimerWheel::LevelCount - 1
+            && delta >= (TimerWheel::SlotCount << (level * TimerWheel::LevelBits)))
+            ++level;
 
-        if (timersCount > 0)
-        {
-            memmove(&(MyTimers[0]), &(MyTimers[1]), timersCount * sizeof(TimerEntry));
-            //  Shifts the remaining items.
+        if unlikely(delta >= WheelSpan)
+            expiry = wheel.Now + WheelSpan - 1;
+        //  Will be cascaded back into the top level until its time comes.
+    }
+
+    unsigned int const slot = (expiry >> (level * TimerWheel::LevelBits)) & TimerWheel::SlotMask;
+    TimerEntry * * const head = &(wheel.Slots[level][slot]);
+
+    if ((entry->Next = *head) != nullptr)
+        entry->Next->Link = &(entry->Next);
+
+    *head = entry;
+    entry->Link = head;
+    entry->Level = (uint8_t)level;
+    entry->Slot = (uint8_t)slot;
 
-            uint32_t next = MyTimers[0].Time;
+    wheel.Occupied[level] |= 1ULL << slot;
+}
+
+static void Unlink(TimerWheel & wheel, TimerEntry * const entry)
+{
+    if ((*(entry->Link) = entry->Next) != nullptr)
+        entry->Next->Link = entry->Link;
 
-            if unlikely(next == 0)
-                next = 1;
-            
-            ApicTimer::SetCount(next);
+    if (wheel.Slots[entry->Level][entry->Slot] == nullptr)
+        wheel.Occupied[entry->Level] &= ~(1ULL << entry->Slot);
+
+    entry->Link = nullptr;
+}
 
-            //  It is VITAL that the timer is used again to guarantee that the
-            //  function runs on the same core again, because the function could
-            //  enable interrupts and get pre-empted or something, and end up
-            //  finishing the interrupt on another core.
+static TimerEntry * Detach(TimerWheel & wheel, unsigned int const level, unsigned int const slot)
+{
+    TimerEntry * const res = wheel.Slots[level][slot];
+
+    wheel.Slots[level][slot] = nullptr;
+    wheel.Occupied[level] &= ~(1ULL << slot);
+
+    return res;
+}
+
+static void Cascade(TimerWheel & wheel, unsigned int const level, unsigned int const slot)
+{
+    for (TimerEntry * entry = Detach(wheel, level, slot), * next; entry != nullptr; entry = next)
+    {
+        next = entry->Next;
+
+        Link(wheel, entry);
+        //  Relative to the current tick, it may go to a lower level.
+    }
+}
+
+static void Advance(TimerWheel & wheel, uint64_t const to)
+{
+    uint64_t const from = wheel.Now;
+
+    wheel.Now = to;
+
+    for (unsigned int level = TimerWheel::LevelCount - 1; level > 0; --level)
+    {
+        unsigned int const shift = level * TimerWheel::LevelBits;
+        uint64_t const passed = Minimum((to >> shift) - (from >> shift) + 1, TimerWheel::SlotCount);
+        unsigned int const first = ((from >> shift) + 1) & TimerWheel::SlotMask;
+
+        for (uint64_t i = 0; i < passed; ++i)
+        {
+            unsigned int const slot = (first + i) & TimerWheel::SlotMask;
+
+            if (0 != (wheel.Occupied[level] & (1ULL << slot)))
+                Cascade(wheel, level, slot);
         }
 
-        END_OF_INTERRUPT();
+        //  Only the slots which the clock went past, plus the one right after,
+        //  can hold entries which belong to a lower level now. Everything else
+        //  stays where it is until the clock gets close to it.
+    }
+}
+
+static bool FindNextTick(TimerWheel & wheel, uint64_t & tick)
+{
+    uint64_t const index = wheel.Now & TimerWheel::SlotMask;
+    uint64_t const bits = wheel.Occupied[0];
+    bool found = false;
+
+    if (bits != 0)
+    {
+        uint64_t const rotated = index == 0 ? bits : ((bits >> index) | (bits << (TimerWheel::SlotCount - index)));
+
+        tick = wheel.Now + __builtin_ctzll(rotated);
+        found = true;
+    }
+    //  Slots of the first level correspond to exact ticks.
+
+    for (unsigned int level = 1; level < TimerWheel::LevelCount; ++level)
+    {
+        uint64_t const upper = wheel.Occupied[level];
+
+        if (upper == 0)
+            continue;
+
+        unsigned int const shift = level * TimerWheel::LevelBits;
+        unsigned int const first = ((wheel.Now >> shift) + 1) & TimerWheel::SlotMask;
+        uint64_t const rotated = first == 0 ? upper : ((upper >> first) | (upper << (TimerWheel::SlotCount - first)));
+        unsigned int const slot = (first + __builtin_ctzll(rotated)) & TimerWheel::SlotMask;
+
+        for (TimerEntry const * entry = wheel.Slots[level][slot]; entry != nullptr; entry = entry->Next)
+            if (!found || entry->Expiry < tick)
+            {
+                tick = entry->Expiry;
+                found = true;
+            }
+
+        //  Upper slots are coarse, so the earliest entry of the first occupied
+        //  one is looked up. Later slots only hold later entries.
+    }
+
+    return found;
+}
+
+static void Arm(TimerWheel & wheel, uint64_t const elapsed)
+{
+    uint64_t target;
+
+    if (!FindNextTick(wheel, target))
+        return;
+    //  Nothing to wait for; the APIC timer stays stopped.
+
+    if (!ApicTimer::TscDeadline)
+    {
+        uint64_t const reach = wheel.Base + ((uint64_t)elapsed + UINT32_MAX) / TickLength;
+
+        if (target > reach)
+            target = reach;
+        //  The APIC counter is only 32 bits wide, so the wheel wakes up on the
+        //  way to far timers. Nothing expires on such a tick.
+    }
+
+    if (wheel.Armed && target >= wheel.Target)
+        return;
+    //  Will fire soon enough.
+
+    wheel.Target = target;
+    wheel.Armed = true;
+
+    if (ApicTimer::TscDeadline)
+        return ApicTimer::SetDeadline(target * TickLength);
+    //  A deadline in the past fires immediately.
+
+    int64_t count = (int64_t)((target - wheel.Base) * TickLength) - (int64_t)elapsed;
+
+    if unlikely(count < 1)
+        count = 1;
+    //  Already late.
+
+    wheel.Elapsed = elapsed;
+    wheel.Count = (uint32_t)count;
+
+    ApicTimer::SetCount(wheel.Count);
+}
+
+static void Insert(TimerWheel & wheel, TimerEntry * const entry, TimeSpanLite const delay)
+{
+    uint64_t elapsed = 0, ticks;
+
+    if (ApicTimer::TscDeadline)
+    {
+        uint64_t const now = CpuInstructions::Rdtsc();
+
+        if (!wheel.Armed)
+            wheel.Now = now / TickLength + 1;
+        //  An idle wheel is empty, so it can skip straight to the present.
 
-        return entry.Function(state, entry.Cookie);
+        entry->Expiry = (now + delay.Value * WheelTicksPerMicrosecond + TickLength - 1) / TickLength;
     }
     else
-        END_OF_INTERRUPT();
+    {
+        if (wheel.Armed)
+            elapsed = wheel.Elapsed + (wheel.Count - ApicTimer::GetCount());
+        else
+            wheel.Base = wheel.Now - 1;
+        //  An idle wheel's clock is stopped, so it restarts from here.
+
+        ticks = (elapsed + delay.Value * WheelTicksPerMicrosecond + TickLength - 1) / TickLength;
+
+        if unlikely(ticks == 0)
+            ticks = 1;
+
+        entry->Expiry = wheel.Base + ticks;
+    }
+
+    Link(wheel, entry);
+    Arm(wheel, elapsed);
+}
+
+static __forceinline bool HasExpired()
+{
+    if (ApicTimer::TscDeadline)
+        return ApicTimer::GetDeadline() == 0;
+    else
+        return ApicTimer::GetCount() == 0;
+}
+
+static __hot void TimerIrqHandler(INTERRUPT_HANDLER_ARGS_FULL)
+{
+    TimerWheel & wheel = Cpu::GetData()->Timers;
+    TimerEntry * expired = nullptr, * * expiredTail = &expired;
+    bool preempt = false;
+
+    withLock (wheel.Lock)
+        if likely(wheel.Armed && HasExpired())
+        {
+            //  Otherwise, this interrupt was pending when the timer got
+            //  re-armed, and there is nothing to do yet.
+
+            uint64_t const target = wheel.Target;
+
+            Advance(wheel, target);
+            //  The timer was armed for the earliest expiry, so no tick in
+            //  between has anything to run. Upper levels are only cascaded
+            //  as far as the clock moved.
+
+            for (TimerEntry * entry = Detach(wheel, 0, target & TimerWheel::SlotMask), * next; entry != nullptr; entry = next)
+            {
+                next = entry->Next;
+                entry->Link = nullptr;
+
+                if (entry->Function == nullptr)
+                    preempt = true;
+                else
+                {
+                    entry->Owner = nullptr;
+
+                    *expiredTail = entry;
+                    expiredTail = &(entry->Next);
+                }
+            }
+
+            *expiredTail = nullptr;
+
+            wheel.Now = target + 1;
+            wheel.Base = target;
+            wheel.Armed = false;
+
+            Arm(wheel, 0);
+        }
+
+    END_OF_INTERRUPT();
+
+    for (TimerEntry * entry = expired, * next; entry != nullptr; entry = next)
+    {
+        next = entry->Next;
+
+        TimedFunction const func = entry->Function;
+        void * const cookie = entry->Cookie;
+
+        EntryAllocator.DeallocateObject(entry);
+        //  Freed first, so the function can enqueue more timers.
+
+        func(state, cookie);
+    }
+
+    if (preempt)
+        Scheduler::Preempt(state);
+    //  The current thread's quantum has expired, so the scheduler gets to pick
+    //  the next one. This is the last thing the handler does.
 }
 
 static SmpLock InitLock {};
@@ -109,9 +368,22 @@ void Timer::Initialize()
     auto const vec = Interrupts::Get(KnownExceptionVectors::ApicTimer);
     //  Unique.
 
-    MyTimersCount = 0;
+    TimerWheel & wheel = Cpu::GetData()->Timers;
+
+    memset(&(wheel.Slots), 0, sizeof(wheel.Slots));
+    memset(&(wheel.Occupied), 0, sizeof(wheel.Occupied));
+
+    wheel.Now = 1;
+    wheel.Armed = false;
+
+    wheel.Preemption.Link = nullptr;
+    wheel.Preemption.Function = nullptr;
+    wheel.Preemption.Owner = &wheel;
     
-    ApicTimer::OneShot(0, vec.GetVector(), false);
+    if (ApicTimer::TscDeadline)
+        ApicTimer::Deadline(vec.GetVector(), false);
+    else
+        ApicTimer::OneShot(0, vec.GetVector(), false);
 
     //  A lock is used here because this code must only be executed once, and
     //  other cores should wait for it to finish.
@@ -121,6 +393,21 @@ void Timer::Initialize()
         if (Initialized)
             return;
 
+        WheelTicksPerMicrosecond = ApicTimer::TscDeadline
+            ? ApicTimer::TscTicksPerMicrosecond
+            : ApicTimer::TicksPerMicrosecond;
+        TickLength = Granularity * WheelTicksPerMicrosecond;
+
+        new (&EntryAllocator) ObjectAllocatorSmp(sizeof(TimerEntry), __alignof(TimerEntry)
+            , &AcquirePoolInKernelHeap, &EnlargePoolInKernelHeap, &ReleasePoolFromKernelHeap
+            , PoolReleaseOptions::NoRelease);
+        //  Entries are never unmapped, so stale handles can always be checked.
+
+#if defined(__BEELZEBUB_SETTINGS_SMP)
+        EntryAllocator.EnableMagazines();
+        //  Every core enqueues and retires its own timers.
+#endif
+
         vec.SetHandler(&TimerIrqHandler);
         vec.SetEnder(&Lapic::IrqEnder);
 
@@ -130,68 +417,81 @@ void Timer::Initialize()
 
 /*  Operation  */
 
-bool Timer::Enqueue(TimeSpanLite delay, TimedFunction func, void * cookie)
+TimerHandle Timer::Enqueue(TimeSpanLite delay, TimedFunction func, void * cookie)
 {
-    uint64_t ticks = delay.Value * ApicTimer::TicksPerMicrosecond;
+    if unlikely(func == nullptr)
+        return {nullptr, 0};
+    //  Reserved for the preemption entry.
 
-    if unlikely(ticks > 0xFFFFFFFFULL)
-        return false;
-    else if unlikely(ticks == 0)
-        ticks = 1;
+    TimerEntry * entry;
 
-    InterruptGuard<> intGuard;
+    if unlikely(!EntryAllocator.AllocateObject(entry).IsOkayResult())
+        return {nullptr, 0};
 
-    uint_fast16_t timersCount = MyTimersCount;
+    entry->Function = func;
+    entry->Cookie = cookie;
 
-    if unlikely(timersCount == Timer::Count)
-        return false;
+    InterruptGuard<> intGuard;
 
-    if likely(timersCount > 0)
-    {
-        //  If there are some timers already queued, the full algorithm needs to
-        //  be employed.
+    TimerWheel & wheel = Cpu::GetData()->Timers;
+    uint64_t const sequence = NextSequence++;
 
-        ticks += MyTimers[0].Time - ApicTimer::GetCount();
-        //  Add the already-elapsed time to the target time.
+    withLock (wheel.Lock)
+    {
+        entry->Sequence = sequence;
+        entry->Owner = &wheel;
 
-        uint64_t lastTicks = 0;
-        unsigned int i = 0;
+        Insert(wheel, entry, delay);
+    }
 
-        for (uint64_t acc = 0; i < timersCount && (acc += MyTimers[i].Time) <= ticks; ++i)
-            lastTicks = acc;
+    return {entry, sequence};
+}
 
-        uint32_t diff = (uint32_t)(ticks - lastTicks);
+bool Timer::Cancel(TimerHandle const handle)
+{
+    TimerEntry * const entry = handle.Entry;
 
-        if (i < timersCount)
-        {
-            memmove(&(MyTimers[i + 1]), &(MyTimers[i]), (timersCount - i) * sizeof(TimerEntry));
-            //  Shift forward the elements after the insertion point.
+    if unlikely(entry == nullptr)
+        return false;
 
-            MyTimers[i + 1].Time -= diff;
-            //  Adjust timer after insertion point.
-        }
+    TimerWheel * const wheel = entry->Owner;
 
-        if (i == 0)
-            ApicTimer::SetCount(diff);
+    if (wheel == nullptr)
+        return false;
+    //  Already fired or cancelled.
 
-        MyTimers[i].Time = diff;
-        MyTimers[i].Function = func;
-        MyTimers[i].Cookie = cookie;
+    InterruptGuard<> intGuard;
 
-        ++MyTimersCount;
-    }
-    else
+    withLock (wheel->Lock)
     {
-        //  No timers means a simple insertion at the first position.
+        if (entry->Owner != wheel || entry->Sequence != handle.Sequence || entry->Link == nullptr)
+            return false;
+        //  The entry was reused since.
 
-        ApicTimer::SetCount((uint32_t)ticks);
+        Unlink(*wheel, entry);
 
-        MyTimers[0].Time = (uint32_t)ticks;
-        MyTimers[0].Function = func;
-        MyTimers[0].Cookie = cookie;
-
-        MyTimersCount = 1;
+        entry->Owner = nullptr;
     }
 
+    EntryAllocator.DeallocateObject(entry);
+    //  The APIC timer may still fire for it, but it will find nothing to do.
+
     return true;
 }
+
+/*  Preemption  */
+
+void Timer::ArmPreemption(TimeSpanLite quantum)
+{
+    InterruptGuard<> intGuard;
+
+    TimerWheel & wheel = Cpu::GetData()->Timers;
+
+    withLock (wheel.Lock)
+    {
+        if (wheel.Preemption.Link != nullptr)
+            Unlink(wheel, &(wheel.Preemption));
+
+        Insert(wheel, &(wheel.Preemption), quantum);
+    }
+}
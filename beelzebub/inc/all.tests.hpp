@@ -122,3 +122,7 @@
 #ifdef __BEELZEBUB__TEST_VMM
 #include "tests/vmm.hpp"
 #endif
+
+#ifdef __BEELZEBUB__TEST_SCHED
+#include "tests/scheduler.hpp"
+#endif
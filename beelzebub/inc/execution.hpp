@@ -43,5 +43,15 @@
 
 namespace Beelzebub
 {
-    Handle SpawnProcess();
+    /**
+     *  Creates a copy of the current process, which shares all its memory
+     *  copy-on-write. No threads are created in it.
+     */
+    Handle SpawnProcess(Execution::Process * & child);
+
+    /**
+     *  Destroys a process spawned by the current one, which must not have run
+     *  any threads.
+     */
+    void DiscardProcess(Execution::Process * const child);
 }
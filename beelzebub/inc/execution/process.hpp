@@ -41,6 +41,7 @@
 
 #include "execution/process.arc.hpp"
 #include "memory/vas.hpp"
+#include "utils/core_set.hpp"
     
 #include <beel/structs.kernel.hpp>
 #include <beel/sync/smp.lock.hpp>
@@ -61,6 +62,7 @@ namespace Beelzebub { namespace Execution
             : ProcessBase( 0xFFFF)
             , ProcessArchitecturalBase()
             , ActiveCoreCount(0)
+            , ActiveCores()
             , LocalTablesLock()
             , AlienPagingTablesLock()
             , PagingTable(nullpaddr)
@@ -77,6 +79,7 @@ namespace Beelzebub { namespace Execution
             : ProcessBase( pid)
             , ProcessArchitecturalBase()
             , ActiveCoreCount(0)
+            , ActiveCores()
             , LocalTablesLock()
             , AlienPagingTablesLock()
             , PagingTable(pt)
@@ -91,6 +94,8 @@ namespace Beelzebub { namespace Execution
         __hot Handle SwitchTo(Process * const other);
 
         Synchronization::Atomic<size_t> ActiveCoreCount;
+        CoreSet ActiveCores;
+        //  Cores whose TLBs may hold translations of this process' userland.
 
         /*  Memory  */
 
@@ -0,0 +1,135 @@
+/*
+    Copyright (c) 2017 Alexandru-Mihai Maftei. All rights reserved.
+
+
+    Developed by: Alexandru-Mihai Maftei
+    aka Vercas
+    http://vercas.com | https://github.com/vercas/Beelzebub
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal with the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+      * Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimers.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimers in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the names of Alexandru-Mihai Maftei, Vercas, nor the names of
+        its contributors may be used to endorse or promote products derived from
+        this Software without specific prior written permission.
+
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    WITH THE SOFTWARE.
+
+    ---
+
+    You may also find the text of this license in "LICENSE.md", along with a more
+    thorough explanation regarding other files.
+*/
+
+#pragma once
+
+#include <execution/thread.hpp>
+#include <beel/sync/smp.lock.hpp>
+#include <beel/sync/atomic.hpp>
+#include <beel/timing.hpp>
+
+namespace Beelzebub { namespace System
+{
+    struct CpuData;
+}}
+
+namespace Beelzebub { namespace Execution
+{
+    /**
+     *  A queue of threads ready to run on a specific core.
+     */
+    struct RunQueue
+    {
+        /*  Operations  */
+
+        void Push(Thread * const thread);
+        Thread * Pop();
+        Thread * PopBackUnpinned();
+
+        /*  Properties  */
+
+        __forceinline size_t GetLength() const
+        {
+            return this->Length.Load(Synchronization::MemoryOrder::Relaxed);
+        }
+
+        /*  Fields  */
+
+        Synchronization::SmpLock Lock {};
+
+        Thread * Head = nullptr;
+        Thread * Tail = nullptr;
+        Synchronization::Atomic<size_t> Length {0};
+        //  Read without the lock by other cores looking for work to steal.
+
+        Thread * Idle = nullptr;
+        //  Runs only when nothing else is available. Never queued.
+
+        Thread * Departing = nullptr;
+        //  The thread which was switched out last. It is published on the
+        //  next scheduling event, once its stack is no longer in use.
+
+        TimeSpanLite Quantum {0};
+        //  How long a thread runs on this core before being preempted.
+    };
+
+    /**
+     *  <summary>Distributes threads over the cores of the system.</summary>
+     */
+    class Scheduler
+    {
+    public:
+        /*  Statics  */
+
+        static TimeSpanLite const DefaultQuantum;
+
+        static constexpr size_t const StealThreshold = 2;
+        static constexpr size_t const ZeroingBatch = 8;
+
+    protected:
+        /*  Constructor(s)  */
+
+        Scheduler() = default;
+
+    public:
+        Scheduler(Scheduler const &) = delete;
+        Scheduler & operator =(Scheduler const &) = delete;
+
+        /*  Initialization  */
+
+        static __startup void Initialize();
+
+        /*  Operation  */
+
+        static Handle Enqueue(Thread * const thread);
+        static Handle Enqueue(Thread * const thread, System::CpuData * const data);
+
+        static __hot Thread * PickNext(System::CpuData * const data, bool const idle);
+        static __hot void Schedule(ThreadState * const state);
+        static __hot void Preempt(ThreadState * const state);
+
+        /*  Properties  */
+
+        static Handle SetQuantum(TimeSpanLite const val);
+        static Handle SetQuantum(TimeSpanLite const val, System::CpuData * const data);
+        static TimeSpanLite GetQuantum();
+
+        static __noreturn void Idle();
+    };
+}}
@@ -62,6 +62,9 @@ namespace Beelzebub { namespace Execution
             , KernelStackPointer()
             , State()
             , ExtendedState(nullptr)
+            , LastCore(~((size_t)0))
+            , Pinned(false)
+            , InvalidationBatchDepth(0)
             , Previous(nullptr)
             , Next(nullptr)
             , EntryPoint()
@@ -79,6 +82,9 @@ namespace Beelzebub { namespace Execution
             , KernelStackPointer()
             , State()
             , ExtendedState(nullptr)
+            , LastCore(~((size_t)0))
+            , Pinned(false)
+            , InvalidationBatchDepth(0)
             , Previous(nullptr)
             , Next(nullptr)
             , EntryPoint()
@@ -89,7 +95,11 @@ namespace Beelzebub { namespace Execution
         /*  Operations  */
 
         __hot Handle SwitchTo(Thread * const other, ThreadState * const dest);    //  Implemented in architecture-specific code.
-        Handle SwitchToNext(ThreadState * const dest) { return this->SwitchTo(this->Next, dest); }
+
+        /**
+         *  Frees the extended state of a thread which will not run anymore.
+         */
+        Handle DisposeExtendedState();
 
         /*  Properties  */
 
@@ -107,14 +117,20 @@ namespace Beelzebub { namespace Execution
         ThreadState State;
         void * ExtendedState;
 
+        size_t LastCore;
+        //  Index of the core which last switched this thread out.
+
+        bool Pinned;
+        //  Pinned threads are never stolen by other cores.
+
+        size_t InvalidationBatchDepth;
+        //  How many TLB invalidation batches this thread has open.
+
         /*  Linkage  */
 
         Thread * Previous;
         Thread * Next;
-
-        Handle IntroduceNext(Thread * const other);
-
-        //  TODO: Eventually implement a proper scheduler and drop the linkage system.
+        //  Used by the run queue which contains the thread, if any.
 
         /*  Parameters  */
 
@@ -83,6 +83,17 @@ namespace Beelzebub { namespace Memory
         AllocateOnDemand     = 0x000000C0,
 
         StrategyMask         = 0x000000F0,
+
+        //  Faults on demand-allocated pages also populate their neighbours.
+        FaultAround          = 0x00000100,
+
+        //  The (usable) virtual range will start on a 2-MiB boundary.
+        Align2MiB            = 0x00001000,
+        //  The (usable) virtual range will start on a 1-GiB boundary.
+        Align1GiB            = 0x00002000,
+
+        AlignmentMask        = 0x00003000,
+
         UniquenessMask       = 0x0000000F,
     };
 
@@ -59,7 +59,7 @@
     {
         /*  First, the normal SMP-aware object allocator.  */
         #define OBJA_POOL_TYPE      ObjectPoolSmp
-        #define OBJA_ALOC_TYPE      ObjectAllocatorSmp
+        #define OBJA_ALOC_TYPE      ObjectAllocatorSmpBase
         #define OBJA_MULTICONSUMER  true
         #define OBJA_UNINTERRUPTED  true
         #include <memory/object_allocator_hbase.inc>
@@ -67,6 +67,112 @@
         #undef OBJA_MULTICONSUMER
         #undef OBJA_ALOC_TYPE
         #undef OBJA_POOL_TYPE
+
+        /*  Then, the per-core magazines which can sit in front of it.  */
+
+        /**
+         *  <summary>A core's private stack of free objects of one allocator.</summary>
+         */
+        struct ObjectMagazine
+        {
+            /*  Constants  */
+
+            static constexpr size_t const Capacity = 32;
+            static constexpr size_t const Batch = Capacity / 2;
+            //  Objects are exchanged with the pools in batches of this size.
+
+            /*  Fields  */
+
+            size_t Count = 0;
+            void * Objects[Capacity];
+        };
+
+        static constexpr size_t const ObjectMagazineSlots = 4;
+        //  This many allocators can have magazines. Every core has a magazine
+        //  for each of them.
+
+        /**
+         *  <summary>
+         *  SMP-aware object allocator which can keep a per-core magazine of
+         *  free objects in front of its pools.
+         *  </summary>
+         */
+        class ObjectAllocatorSmp : public ObjectAllocatorSmpBase
+        {
+        public:
+            /*  Constructors  */
+
+            inline ObjectAllocatorSmp()
+                : ObjectAllocatorSmpBase()
+                , MagazineSlot(ObjectMagazineSlots)
+            {
+
+            }
+
+            ObjectAllocatorSmp(ObjectAllocatorSmp const &) = delete;
+            ObjectAllocatorSmp & operator =(const ObjectAllocatorSmp &) = delete;
+
+            inline ObjectAllocatorSmp(size_t const objectSize, size_t const objectAlignment
+                , AcquirePoolFunc acquirer, EnlargePoolFunc enlarger, ReleasePoolFunc releaser
+                , PoolReleaseOptions const releaseOptions = PoolReleaseOptions::ReleaseAll
+                , size_t const busyBit = SIZE_MAX, size_t const quota = SIZE_MAX)
+                : ObjectAllocatorSmpBase(objectSize, objectAlignment, acquirer, enlarger
+                    , releaser, releaseOptions, busyBit, quota)
+                , MagazineSlot(ObjectMagazineSlots)
+            {
+
+            }
+
+            /*  Methods  */
+
+            template<typename T>
+            inline Handle AllocateObject(T * & result, size_t estimatedLeft = 1)
+            {
+                if (sizeof(T) > this->ObjectSize)
+                    return HandleResult::ArgumentTemplateInvalid;
+
+                void * pRes;
+
+                Handle hRes = this->AllocateObject(pRes, estimatedLeft);
+
+                result = (T *)pRes;
+
+                return hRes;
+            }
+
+            __hot __noinline Handle AllocateObject(void * & result, size_t estimatedLeft = 1);
+            __hot __noinline Handle DeallocateObject(void * const object);
+
+            /**
+             *  <summary>
+             *  Gives this allocator a magazine on every core. Objects sitting
+             *  in magazines count as busy, and freeing them is not validated
+             *  until they are returned to the pools.
+             *  </summary>
+             *  <remarks>
+             *  Magazines cannot be taken back, so the allocator must not be
+             *  disposed afterwards.
+             *  </remarks>
+             */
+            __cold Handle EnableMagazines();
+
+            /// <summary>Returns the objects in the current core's magazine to the pools.</summary>
+            __cold void FlushMagazine();
+
+            __cold __noinline void Dispose();
+
+            /*  Properties  */
+
+            inline bool HasMagazines() const
+            {
+                return this->MagazineSlot < ObjectMagazineSlots;
+            }
+
+        private:
+            /*  Fields  */
+
+            size_t MagazineSlot;
+        };
     }}
 
     #undef OBJA_COOK_TYPE
@@ -70,6 +70,32 @@ namespace Beelzebub { namespace Memory
         { return AllocateFrame(size, magn, refCnt); }
 
         static __hot __solid Handle FreeFrame(paddr_t addr, bool ignoreRefCnt = true);
+
+        /**
+         *  Allocates a batch of frames, which need not be contiguous.
+         *  Returns how many were allocated.
+         */
+        static __hot __solid size_t AllocateFrames(paddr_t * frames, size_t count
+            , FrameSize size = FrameSize::_4KiB, uint32_t refCnt = 0);
+
+        /**
+         *  Allocates a run of physically contiguous frames, aligned to its size
+         *  rounded up to a power of two. Every frame in the run is counted
+         *  separately.
+         */
+        static __hot __solid paddr_t AllocateContiguous(size_t count
+            , FrameSize size = FrameSize::_4KiB, AddressMagnitude magn = AddressMagnitude::Any
+            , uint32_t refCnt = 0);
+        static __hot __solid Handle FreeContiguous(paddr_t addr, size_t count
+            , FrameSize size = FrameSize::_4KiB);
+        /**
+         *  Takes a frame from the pool of pre-zeroed frames of the current
+         *  core's node, or returns null if it is empty.
+         */
+        static __hot __solid paddr_t AllocateZeroedFrame();
+        static __hot __solid bool StoreZeroedFrame(paddr_t addr);
+        static __hot __solid size_t GetZeroedFrameShortage();
+
         static __cold __solid Handle ReserveRange(paddr_t start, size_t size, bool includeBusy = false);
 
         static __hot __solid Handle AdjustReferenceCount(paddr_t addr, uint32_t & newCnt, int32_t diff);
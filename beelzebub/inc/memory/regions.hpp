@@ -122,6 +122,7 @@ namespace Beelzebub { namespace Memory
             , Content()
             , Next(nullptr)
             , Prev(nullptr)
+            , FreeGap(0)
         {
 
         }
@@ -136,6 +137,7 @@ namespace Beelzebub { namespace Memory
             , Content(content)
             , Next(nullptr)
             , Prev(nullptr)
+            , FreeGap(0)
         {
 
         }
@@ -150,6 +152,7 @@ namespace Beelzebub { namespace Memory
             , Content(content)
             , Next(nullptr)
             , Prev(nullptr)
+            , FreeGap(0)
         {
 
         }
@@ -165,6 +168,7 @@ namespace Beelzebub { namespace Memory
             , Content(content)
             , Next(next)
             , Prev(prev)
+            , FreeGap(0)
         {
 
         }
@@ -202,6 +206,10 @@ namespace Beelzebub { namespace Memory
         MemoryContent Content;
 
         MemoryRegion * Next, * Prev;
+
+        vsize_t FreeGap;
+        //  Size of the largest free region in the tree under this one's node.
+        //  Maintained by the region tree.
     };
 
     struct AdjacentMemoryRegion
@@ -221,3 +229,11 @@ namespace Beelzebub { namespace Memory
         MemoryRegion Finding;
     };
 }}
+
+namespace Beelzebub { namespace Utils
+{
+    template<typename TPayload>
+    class AvlTreeNode;
+
+    void AugmentNode(AvlTreeNode<Memory::MemoryRegion> * const node);
+}}
@@ -45,6 +45,7 @@
 
 #include <beel/utils/avl.tree.hpp>
 #include <beel/sync/rw.ticket.lock.hpp>
+#include <beel/sync/smp.lock.hpp>
 #include <beel/sync/atomic.hpp>
 
 namespace Beelzebub { namespace Memory
@@ -55,6 +56,10 @@ namespace Beelzebub { namespace Memory
     class Vas
     {
     public:
+        /*  Statics  */
+
+        static constexpr size_t const RangeLockCount = 16;
+
         /*  Constructors  */
 
         inline Vas()
@@ -62,7 +67,9 @@ namespace Beelzebub { namespace Memory
             , Alloc()
             , Tree()
             , First(nullptr)
-            , LastSearched(nullptr)
+            , Sequence(0)
+            , RangesLock()
+            , LockedRanges()
         {
             this->Tree.Cookie = this;
         }
@@ -79,7 +86,8 @@ namespace Beelzebub { namespace Memory
 
         __hot Handle Allocate(vaddr_t & vaddr, size_t size
             , MemoryFlags flags, MemoryContent content
-            , MemoryAllocationOptions type, bool lock = true);
+            , MemoryAllocationOptions type, bool lock = true
+            , vsize_t alignment = PageSize);
 
         __hot Handle Free(vaddr_t vaddr, size_t size
             , bool sparse = false, bool tolerant = false, bool lock = true);
@@ -87,8 +95,68 @@ namespace Beelzebub { namespace Memory
         __hot Handle Modify(vaddr_t vaddr, size_t pageCnt
             , MemoryFlags flags, bool lock = true);
 
+        /**
+         *  Reproduces the regions of another address space in this one, which
+         *  must be blank. The source must be locked by the caller.
+         */
+        __cold Handle Clone(Vas const & source);
+
+        /**
+         *  Frees all the regions of this address space, which nothing may use
+         *  anymore.
+         */
+        __cold void Dispose();
+
         __hot MemoryRegion * FindRegion(vaddr_t vaddr);
 
+        /**
+         *  Copies the region containing the given address without taking the
+         *  lock. Returns false when a writer got in the way. Otherwise, `seq`
+         *  receives the sequence number the copy is valid for, and the copy is
+         *  invalid if no region contains the address. Interrupts must be
+         *  disabled, because the last region found is cached per core.
+         */
+        __hot bool TryFindRegion(vaddr_t vaddr, MemoryRegion & reg, uint64_t & seq) const;
+
+        /*  Synchronization  */
+
+        //  Writers keep the sequence number odd while they hold the lock.
+
+        __hot __forceinline void AcquireAsWriter()
+        {
+            this->Lock.AcquireAsWriter();
+
+            ++this->Sequence;
+        }
+
+        __hot __forceinline void ReleaseAsWriter()
+        {
+            ++this->Sequence;
+
+            this->Lock.ReleaseAsWriter();
+        }
+
+        __hot __forceinline bool HasChangedSince(uint64_t const seq) const
+        {
+            COMPILER_MEMORY_BARRIER();
+
+            return this->Sequence.Load() != seq;
+        }
+
+        /**
+         *  Claims a range of addresses whose pages are being (un)mapped, waiting
+         *  for any overlapping claims to end. Operations on disjoint ranges do
+         *  not wait for each other, and only hold the lock while the regions
+         *  themselves change. Interrupts are let through while waiting.
+         */
+        __hot void LockRange(vaddr_t start, vaddr_t end);
+        __hot void UnlockRange(vaddr_t start, vaddr_t end);
+
+        /**
+         *  Waits until no claimed range overlaps the given one.
+         */
+        __hot void WaitForRange(vaddr_t start, vaddr_t end);
+
         /*  Support  */
 
         __hot Handle AllocateNode(Utils::AvlTree<MemoryRegion>::Node * & node);
@@ -118,6 +186,11 @@ namespace Beelzebub { namespace Memory
         ObjectAllocator Alloc;
         Utils::AvlTree<MemoryRegion> Tree;
 
-        MemoryRegion * First, * LastSearched;
+        MemoryRegion * First;
+
+        Synchronization::Atomic<uint64_t> Sequence;
+
+        Synchronization::SmpLockUni RangesLock;
+        MemoryRange LockedRanges[RangeLockCount];
     };
 }}
@@ -106,6 +106,9 @@ namespace Beelzebub { namespace Memory
         static vaddr_t KernelStart;
         static vaddr_t KernelEnd;
 
+        static size_t FullFlushThreshold;
+        static size_t FaultAroundPages;
+
         /*  Utils  */
 
         static Handle AcquirePoolForVas(size_t objectSize, size_t headerSize
@@ -155,6 +158,54 @@ namespace Beelzebub { namespace Memory
             , MemoryFlags const flags
             , MemoryMapOptions opts = MemoryMapOptions::None);
 
+        /**
+         *  Maps up to 64 consecutive small pages onto the given frames, walking
+         *  the paging tables once. The pages must lie within the same large
+         *  page. Pages which are already mapped are skipped, and the bits of
+         *  the ones that were mapped are set in `mapped`.
+         */
+        static __hot __solid Handle MapPages(Execution::Process * proc
+            , uintptr_t const vaddr, paddr_t const * frames, size_t const count
+            , MemoryFlags const flags, uint64_t & mapped
+            , MemoryMapOptions opts = MemoryMapOptions::None);
+
+        /**
+         *  Points a mapped page at another frame of the same size in one step,
+         *  so other threads never find it unmapped. Fails with PageMapped if
+         *  the page no longer maps the expected frame.
+         */
+        static __hot __solid Handle ReplacePage(Execution::Process * proc
+            , uintptr_t const vaddr, paddr_t const expected, paddr_t const paddr
+            , MemoryFlags const flags
+            , MemoryMapOptions opts = MemoryMapOptions::None);
+
+        /**
+         *  Gives a page new flags if it still maps the expected frame and holds
+         *  the only reference to it, checking both under the same lock that
+         *  cloning shares frames under. Fails with PageMapped otherwise.
+         */
+        static __hot __solid Handle ClaimPage(Execution::Process * proc
+            , uintptr_t const vaddr, paddr_t const expected
+            , MemoryFlags const flags);
+
+        /**
+         *  Shares all the userland pages of the current process with a freshly
+         *  initialized one, by copying the paging tables. Writable pages turn
+         *  read-only in both until either writes to them. Interrupts are let
+         *  through between tables, so the parent's regions may change meanwhile.
+         */
+        static __cold __solid Handle CloneTables(Execution::Process * parent
+            , Execution::Process * child);
+
+        /**
+         *  Undoes a whole or partial CloneTables: the child's references are
+         *  dropped, and all its paging tables are freed. Pages the parent no
+         *  longer shares turn writable again. The parent's regions must not be
+         *  locked by the caller, as interrupts are let through between tables.
+         */
+        static __cold __solid void DiscardTables(Execution::Process * parent
+            , Execution::Process * child);
+
         static __hot __solid Handle UnmapPage(Execution::Process * proc
             , uintptr_t const vaddr, paddr_t & paddr, FrameSize & size
             , MemoryMapOptions opts = MemoryMapOptions::None);
@@ -213,17 +264,57 @@ namespace Beelzebub { namespace Memory
             return InvalidateChain(proc, {vaddr}, broadcast);
         }
 
+        /**
+         *  Gathers the broadcast invalidations performed by the current thread,
+         *  and the frames unmapped along with them, until the outermost batch
+         *  ends. The unmapped virtual ranges must not be freed before then.
+         *  Interrupts are only disabled while a batch is filled or flushed.
+         */
+        static __hot void BeginInvalidationBatch();
+        static __hot Handle EndInvalidationBatch();
+
+        /**
+         *  Performs the invalidations gathered on this core so far. Must be
+         *  called with interrupts disabled before the current thread is
+         *  switched out, since the thread may resume on another core.
+         */
+        static __hot void FlushInvalidationBatch();
+
         static __hot __solid Handle Translate(Execution::Process * proc
             , uintptr_t const vaddr, paddr_t & paddr, bool const lock = true);
 
         static __hot Handle HandlePageFault(Execution::Process * proc
             , uintptr_t const vaddr, PageFaultFlags const flags);
 
+        /**
+         *  Makes sure every page in the given userland range is backed by a
+         *  frame of its own, as a write would, but regardless of whether the
+         *  pages are writable. Required before writing to them with write
+         *  protection disabled. Interrupts must be disabled.
+         */
+        static __hot Handle UnsharePages(Execution::Process * proc
+            , uintptr_t const vaddr, size_t const size);
+
+        /**
+         *  Zeroes up to the given number of frames for the pool of the current
+         *  core's node, through a window only this core uses. Returns how many
+         *  were added.
+         */
+        static __hot size_t PrepareZeroedFrames(size_t count);
+
+        /**
+         *  Fills a frame with a copy of the given page, or with the given byte
+         *  if it is null, through a window only the current core uses.
+         */
+        static __hot Handle FillFrame(paddr_t const frame, void const * const src
+            , uint8_t const fill = 0);
+
         /*  Allocation  */
 
         static __hot __solid Handle AllocatePages(Execution::Process * proc
             , size_t const size, MemoryAllocationOptions const type
-            , MemoryFlags const flags, MemoryContent content, uintptr_t & vaddr);
+            , MemoryFlags const flags, MemoryContent content, uintptr_t & vaddr
+            , size_t const alignment = PageSize);
 
         static __hot __solid Handle FreePages(Execution::Process * proc
             , uintptr_t const vaddr, size_t const size);
@@ -41,17 +41,92 @@
 
 #include <beel/timing.hpp>
 #include <system/interrupts.hpp>
+#include <beel/sync/smp.lock.hpp>
 #include <beel/handles.h>
 
 namespace Beelzebub
 {
     typedef void (* TimedFunction)(System::IsrState * const state, void * cookie);
 
+    struct TimerWheel;
+
+    /**
+     *  <summary>A timed function queued in a wheel.</summary>
+     */
     struct TimerEntry
     {
+        TimerEntry * Next;
+        TimerEntry * * Link;
+        //  Points to the pointer which points to this entry; null when the
+        //  entry isn't in a wheel.
+
         TimedFunction Function;
+        //  Null for the entry which marks the end of the current quantum.
         void * Cookie;
-        uint32_t Time;
+
+        uint64_t Expiry;
+        //  Absolute, in wheel ticks.
+        uint64_t Sequence;
+        TimerWheel * Owner;
+        uint8_t Level, Slot;
+    };
+
+    /**
+     *  <summary>Identifies a timer queued on a specific core.</summary>
+     */
+    struct TimerHandle
+    {
+        /*  Properties  */
+
+        inline bool IsValid() const { return this->Entry != nullptr; }
+        inline explicit operator bool() const { return this->IsValid(); }
+
+        /*  Fields  */
+
+        TimerEntry * Entry;
+        uint64_t Sequence;
+        //  Distinguishes the timer from others which reuse the same entry.
+    };
+
+    /**
+     *  <summary>
+     *  A core's hierarchical timing wheel. Each level has 64 slots, each slot
+     *  of a level spanning a whole rotation of the level below.
+     *  </summary>
+     */
+    struct TimerWheel
+    {
+        /*  Statics  */
+
+        static constexpr unsigned int const LevelBits = 6;
+        static constexpr unsigned int const LevelCount = 4;
+        static constexpr uint64_t const SlotCount = 1ULL << LevelBits;
+        static constexpr uint64_t const SlotMask = SlotCount - 1;
+
+        /*  Fields  */
+
+        Synchronization::SmpLock Lock {};
+
+        TimerEntry * Slots[LevelCount][SlotCount];
+        uint64_t Occupied[LevelCount];
+        //  One bit per non-empty slot.
+
+        uint64_t Now;
+        //  The next tick to process.
+        uint64_t Target;
+        //  The tick at which the APIC timer will fire, if armed.
+        bool Armed;
+
+        uint64_t Base;
+        //  The tick at which the APIC timer was last armed.
+        uint64_t Elapsed;
+        //  APIC timer ticks since the base, before the current count was set.
+        uint32_t Count;
+        //  The value the APIC timer's count was last set to.
+        //  These three are only used when counting down; deadlines are absolute.
+
+        TimerEntry Preemption;
+        //  Never allocated nor freed.
     };
 
     /**
@@ -65,7 +140,8 @@ namespace Beelzebub
         static uint64_t Frequency;
         static size_t TicksPerMicrosecond;
 
-        static constexpr uint_fast16_t const Count = 32;
+        static constexpr uint64_t const Granularity = 32;
+        //  Microseconds per wheel tick.
 
     protected:
         /*  Constructor(s)  */
@@ -82,6 +158,11 @@ namespace Beelzebub
 
         /*  Operation  */
 
-        static bool Enqueue(TimeSpanLite delay, TimedFunction func, void * cookie = nullptr);
+        static TimerHandle Enqueue(TimeSpanLite delay, TimedFunction func, void * cookie = nullptr);
+        static bool Cancel(TimerHandle const handle);
+
+        /*  Preemption  */
+
+        static __hot void ArmPreemption(TimeSpanLite quantum);
     };
 }
@@ -0,0 +1,131 @@
+/*
+    Copyright (c) 2017 Alexandru-Mihai Maftei. All rights reserved.
+
+
+    Developed by: Alexandru-Mihai Maftei
+    aka Vercas
+    http://vercas.com | https://github.com/vercas/Beelzebub
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal with the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+      * Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimers.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimers in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the names of Alexandru-Mihai Maftei, Vercas, nor the names of
+        its contributors may be used to endorse or promote products derived from
+        this Software without specific prior written permission.
+
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    WITH THE SOFTWARE.
+
+    ---
+
+    You may also find the text of this license in "LICENSE.md", along with a more
+    thorough explanation regarding other files.
+*/
+
+#pragma once
+
+#include <beel/sync/atomic.hpp>
+
+namespace Beelzebub
+{
+    /**
+     *  A set of core indexes which can be altered concurrently.
+     *
+     *  Cores with indexes beyond the capacity cannot be tracked, so they are
+     *  considered to always be members.
+     */
+    struct CoreSet
+    {
+        /*  Statics  */
+
+        static constexpr size_t const WordBits = 64;
+        static constexpr size_t const WordCount = 4;
+        static constexpr size_t const Capacity = WordCount * WordBits;
+
+        /*  Constructors  */
+
+        inline CoreSet() : Words() { }
+
+        CoreSet(CoreSet const &) = delete;
+        CoreSet & operator =(CoreSet const &) = delete;
+
+        /*  Operations  */
+
+        /**
+         *  Adds a core to the set; returns true if it was already a member.
+         */
+        inline bool Add(size_t const core)
+        {
+            if unlikely(core >= Capacity)
+                return true;
+
+            return this->Words[core / WordBits].TestSet(core % WordBits);
+        }
+
+        /**
+         *  Removes a core from the set; returns true if it was a member.
+         */
+        inline bool Remove(size_t const core)
+        {
+            if unlikely(core >= Capacity)
+                return true;
+
+            return this->Words[core / WordBits].TestClear(core % WordBits);
+        }
+
+        inline bool Contains(size_t const core) const
+        {
+            if unlikely(core >= Capacity)
+                return true;
+
+            return 0 != (this->Words[core / WordBits].Load() & (1ULL << (core % WordBits)));
+        }
+
+        /**
+         *  Calls the given function with the index of every member below the
+         *  given core count.
+         */
+        template<typename TFunc>
+        inline void ForEach(size_t const count, TFunc func) const
+        {
+            for (size_t i = 0; i < WordCount && i * WordBits < count; ++i)
+            {
+                uint64_t word = this->Words[i].Load();
+
+                while (word != 0)
+                {
+                    size_t const core = i * WordBits + __builtin_ctzll(word);
+
+                    if (core >= count)
+                        break;
+
+                    func(core);
+
+                    word &= word - 1;
+                }
+            }
+
+            for (size_t core = Capacity; core < count; ++core)
+                func(core);
+        }
+
+        /*  Fields  */
+
+        Synchronization::Atomic<uint64_t> Words[WordCount];
+    };
+}
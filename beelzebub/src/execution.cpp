@@ -40,14 +40,111 @@
 #include <execution.hpp>
 #include <memory/object_allocator_smp.hpp>
 #include <memory/object_allocator_pools_heap.hpp>
+#include <memory/vmm.hpp>
+#include <system/cpu.hpp>
+
+#include <beel/interrupt.state.hpp>
+#include <beel/sync/smp.lock.hpp>
+#include <beel/sync/atomic.hpp>
+#include <new>
 
 using namespace Beelzebub;
 using namespace Beelzebub::Execution;
 using namespace Beelzebub::Memory;
+using namespace Beelzebub::Synchronization;
+using namespace Beelzebub::System;
 
 ObjectAllocatorSmp ProcessAllocator;
 
-Handle Beelzebub::SpawnProcess()
+static SmpLock ProcessAllocatorLock {};
+static bool ProcessAllocatorReady = false;
+static Atomic<uint16_t> NextProcessId {1};
+//  0 belongs to the bootstrap process.
+
+static size_t const SpawnAttempts = 4;
+//  How many times spawning starts over when the parent's regions change.
+
+Handle Beelzebub::SpawnProcess(Process * & child)
+{
+    Process * const parent = Cpu::GetProcess();
+
+    if unlikely(!__atomic_load_n(&ProcessAllocatorReady, __ATOMIC_ACQUIRE))
+        withLock (ProcessAllocatorLock)
+            if (!ProcessAllocatorReady)
+            {
+                new (&ProcessAllocator) ObjectAllocatorSmp(sizeof(Process), __alignof(Process)
+                    , &AcquirePoolInKernelHeap, &EnlargePoolInKernelHeap, &ReleasePoolFromKernelHeap);
+
+                __atomic_store_n(&ProcessAllocatorReady, true, __ATOMIC_RELEASE);
+            }
+
+    Handle res = ProcessAllocator.AllocateObject(child);
+
+    if unlikely(!res.IsOkayResult())
+        return res;
+
+    uint16_t const id = NextProcessId++;
+    size_t attempts = 0;
+    uint64_t seq;
+
+retry:
+    new (child) Process(id, nullpaddr);
+
+    res = Vmm::Initialize(child);
+
+    if unlikely(!res.IsOkayResult())
+        goto fail;
+
+    withInterrupts (false)
+    {
+        parent->Vas.AcquireAsWriter();
+
+        res = child->Vas.Clone(parent->Vas);
+        seq = parent->Vas.Sequence.Load() + 1;
+        //  What the sequence number becomes once the lock is released.
+
+        parent->Vas.ReleaseAsWriter();
+    }
+
+    if likely(res.IsOkayResult())
+        res = Vmm::CloneTables(parent, child);
+    //  Only the paging tables are copied; the frames are shared. This lets
+    //  interrupts through, so other threads of the parent may change its
+    //  regions meanwhile.
+
+    if unlikely(res.IsOkayResult() && parent->Vas.HasChangedSince(seq))
+    {
+        if (++attempts < SpawnAttempts)
+        {
+            Vmm::DiscardTables(parent, child);
+            child->Vas.Dispose();
+
+            goto retry;
+        }
+
+        res = HandleResult::Timeout;
+    }
+    //  The child's regions would not match its tables.
+
+    if unlikely(!res.IsOkayResult())
+        goto fail;
+
+    child->RuntimeLoaded = parent->RuntimeLoaded;
+
+    return HandleResult::Okay;
+
+fail:
+    DiscardProcess(child);
+    child = nullptr;
+
+    return res;
+}
+
+void Beelzebub::DiscardProcess(Process * const child)
 {
+    Vmm::DiscardTables(Cpu::GetProcess(), child);
+    //  The parent gets back write access to whatever it stops sharing.
 
+    child->Vas.Dispose();
+    ProcessAllocator.DeallocateObject(child);
 }
@@ -177,6 +177,8 @@ rollbackMapping:
     //  It starts with a decrement because vaddr points to a page that failed
     //  to map.
 
+    Vmm::BeginInvalidationBatch();
+
     do
     {
         vaddr -= PageSize;
@@ -188,7 +190,10 @@ rollbackMapping:
             , vaddr, &phdr, res);
     } while (vaddr > segVaddr);
 
-    Vmm::FreePages(proc, segVaddr, (phdr.VSize + PageSize - 1) / PageSize);
+    Vmm::EndInvalidationBatch();
+    //  All the pages are invalidated together, in one shootdown.
+
+    Vmm::FreePages(proc, segVaddr, RoundUp(phdr.VSize, PageSize));
 
     return false;
 }
@@ -229,6 +234,8 @@ bool Execution::UnmapSegment64(uintptr_t loc, ElfProgramHeader_64 const & phdr,
     //  It starts with a decrement because vaddr points to a page that is outside
     //  of the actual segment.
 
+    Vmm::BeginInvalidationBatch();
+
     do
     {
         vaddr -= PageSize;
@@ -240,5 +247,7 @@ bool Execution::UnmapSegment64(uintptr_t loc, ElfProgramHeader_64 const & phdr,
             , vaddr, &phdr, res);
     } while (vaddr > segVaddr);
 
+    Vmm::EndInvalidationBatch();
+
     return true;
 }
@@ -78,6 +78,11 @@ Handle ExtendedStates::Initialize(size_t const size, size_t const alignment)
         new (&ExtendedStatesAllocator) ObjectAllocatorSmp(size, alignment
             , &AcquirePoolInKernelHeap, &EnlargePoolInKernelHeap, &ReleasePoolFromKernelHeap);
 
+#if defined(__BEELZEBUB_SETTINGS_SMP)
+        ExtendedStatesAllocator.EnableMagazines();
+        //  Threads are spawned and torn down on every core.
+#endif
+
         ExtendedStates::Initialized = true;
 
         return HandleResult::Okay;
@@ -0,0 +1,388 @@
+/*
+    Copyright (c) 2017 Alexandru-Mihai Maftei. All rights reserved.
+
+
+    Developed by: Alexandru-Mihai Maftei
+    aka Vercas
+    http://vercas.com | https://github.com/vercas/Beelzebub
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal with the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+      * Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimers.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimers in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the names of Alexandru-Mihai Maftei, Vercas, nor the names of
+        its contributors may be used to endorse or promote products derived from
+        this Software without specific prior written permission.
+
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    WITH THE SOFTWARE.
+
+    ---
+
+    You may also find the text of this license in "LICENSE.md", along with a more
+    thorough explanation regarding other files.
+*/
+
+#include <execution/scheduler.hpp>
+#include <execution/extended_states.hpp>
+#include <system/cpu.hpp>
+#include <system/fpu.hpp>
+#include <memory/vmm.hpp>
+#include <timer.hpp>
+#include <cores.hpp>
+#include <kernel.hpp>
+#include <math.h>
+
+#include <debug.hpp>
+
+using namespace Beelzebub;
+using namespace Beelzebub::Execution;
+using namespace Beelzebub::Memory;
+using namespace Beelzebub::Synchronization;
+using namespace Beelzebub::System;
+
+/****************
+    Internals
+****************/
+
+#if defined(__BEELZEBUB_SETTINGS_SMP)
+static __hot Thread * Steal(CpuData * const data, size_t const threshold)
+{
+    if unlikely(!Cores::IsReady())
+        return nullptr;
+
+    size_t const count = Cores::GetCount();
+
+    CpuData * victim = nullptr;
+    size_t victimLength = threshold - 1;
+
+    for (size_t i = 1; i < count; ++i)
+    {
+        CpuData * const candidate = Cores::Get((data->Index + i) % count);
+        size_t const length = candidate->RunQueue.GetLength();
+
+        if (length > victimLength)
+        {
+            victim = candidate;
+            victimLength = length;
+        }
+    }
+    //  The busiest core is robbed. Lengths are read without locking, so they
+    //  may be slightly out of date; this is only a heuristic anyway.
+
+    if (victim == nullptr)
+        return nullptr;
+
+    RunQueue & rq = victim->RunQueue;
+    Thread * res = nullptr;
+
+    withLock (rq.Lock)
+        if likely(rq.GetLength() >= threshold)
+            res = rq.PopBackUnpinned();
+    //  The tail is taken, being the thread which would wait the longest on the
+    //  victim core. Pinned threads are skipped.
+
+    return res;
+}
+#endif
+
+/*********************
+    RunQueue struct
+*********************/
+
+/*  Operations  */
+
+void RunQueue::Push(Thread * const thread)
+{
+    thread->Next = nullptr;
+
+    if ((thread->Previous = this->Tail) != nullptr)
+        this->Tail->Next = thread;
+    else
+        this->Head = thread;
+
+    this->Tail = thread;
+
+    this->Length.Store(this->Length.Load(MemoryOrder::Relaxed) + 1, MemoryOrder::Relaxed);
+}
+
+Thread * RunQueue::Pop()
+{
+    Thread * const res = this->Head;
+
+    if (res == nullptr)
+        return nullptr;
+
+    if ((this->Head = res->Next) != nullptr)
+        this->Head->Previous = nullptr;
+    else
+        this->Tail = nullptr;
+
+    res->Next = nullptr;
+
+    this->Length.Store(this->Length.Load(MemoryOrder::Relaxed) - 1, MemoryOrder::Relaxed);
+
+    return res;
+}
+
+Thread * RunQueue::PopBackUnpinned()
+{
+    Thread * res = this->Tail;
+
+    while (res != nullptr && (res->Pinned || res == this->Idle))
+        res = res->Previous;
+
+    if (res == nullptr)
+        return nullptr;
+
+    if (res->Next != nullptr)
+        res->Next->Previous = res->Previous;
+    else
+        this->Tail = res->Previous;
+
+    if (res->Previous != nullptr)
+        res->Previous->Next = res->Next;
+    else
+        this->Head = res->Next;
+
+    res->Previous = res->Next = nullptr;
+
+    this->Length.Store(this->Length.Load(MemoryOrder::Relaxed) - 1, MemoryOrder::Relaxed);
+
+    return res;
+}
+
+/**********************
+    Scheduler class
+**********************/
+
+/*  Statics  */
+
+TimeSpanLite const Scheduler::DefaultQuantum {10 * 1000};
+//  Microseconds.
+
+/*  Initialization  */
+
+void Scheduler::Initialize()
+{
+    CpuData * const data = Cpu::GetData();
+
+    if (data->RunQueue.Quantum.Value == 0)
+        data->RunQueue.Quantum = DefaultQuantum;
+    //  May have been configured before the core started scheduling.
+
+    Timer::ArmPreemption(data->RunQueue.Quantum);
+}
+
+/*  Operation  */
+
+Handle Scheduler::Enqueue(Thread * const thread)
+{
+    InterruptGuard<> intGuard;
+    //  Keeps this code on the same core.
+
+    return Enqueue(thread, Cpu::GetData());
+}
+
+Handle Scheduler::Enqueue(Thread * const thread, CpuData * const data)
+{
+    if unlikely(thread == nullptr || data == nullptr)
+        return HandleResult::ArgumentNull;
+
+    RunQueue & rq = data->RunQueue;
+
+    if unlikely(thread == rq.Idle)
+        return HandleResult::Okay;
+    //  Idle threads are run when their queue is empty, and never queued.
+
+    InterruptGuard<> intGuard;
+    //  The scheduler of the same core may want the lock.
+
+    withLock (rq.Lock)
+        rq.Push(thread);
+
+    return HandleResult::Okay;
+}
+
+Thread * Scheduler::PickNext(CpuData * const data, bool const idle)
+{
+    RunQueue & rq = data->RunQueue;
+    Thread * res;
+
+    withLock (rq.Lock)
+    {
+        if (rq.Departing != nullptr)
+        {
+            rq.Push(rq.Departing);
+
+            rq.Departing = nullptr;
+        }
+
+        res = rq.Pop();
+    }
+
+#if defined(__BEELZEBUB_SETTINGS_SMP)
+    if (res == nullptr)
+        res = Steal(data, idle ? 1 : StealThreshold);
+    //  A core with nothing else to run steals work from the others. A busy
+    //  core only steals from those even busier, to avoid ping-ponging threads.
+#else
+    (void)idle;
+#endif
+
+    if (res == nullptr)
+        res = rq.Idle;
+    //  Nothing else is runnable, so the core idles for a while. It is null
+    //  until the core starts idling.
+
+    return res;
+}
+
+void Scheduler::Schedule(ThreadState * const state)
+{
+    CpuData * const data = Cpu::GetData();
+    Thread * const current = Cpu::GetThread();
+    RunQueue & rq = data->RunQueue;
+
+    if likely(current != nullptr)
+    {
+        //  Cores which haven't started their idle thread aren't scheduled.
+
+        bool const idle = current == rq.Idle;
+
+        Thread * const next = PickNext(data, idle);
+
+        if (next != nullptr && next != current)
+        {
+            current->State = *state;
+
+            Vmm::FlushInvalidationBatch();
+            //  The current thread may continue on another core, so whatever it
+            //  gathered here must be invalidated now.
+
+            Handle res = current->SwitchTo(next, state);
+
+            if unlikely(!res.IsOkayResult())
+            {
+                if (next != rq.Idle)
+                    withLock (rq.Lock)
+                        rq.Push(next);
+            }
+            else if (!idle)
+                rq.Departing = current;
+            //  The interrupt is still being handled on the stack of the current
+            //  thread, so it cannot be queued (and stolen) until the next
+            //  scheduling event.
+        }
+        //  Otherwise, there is nothing else to run; the current thread
+        //  continues. This only happens to the idle thread, or before there
+        //  is one; other threads make way for it when the queue runs dry.
+    }
+
+    if likely(rq.Quantum.Value != 0)
+        Timer::ArmPreemption(rq.Quantum);
+    //  Whichever thread runs now gets a full quantum. The quantum is zero until
+    //  the scheduler is initialized on this core.
+}
+
+void Scheduler::Preempt(ThreadState * const state)
+{
+    if (Scheduling)
+        return Schedule(state);
+
+    Timer::ArmPreemption(Cpu::GetData()->RunQueue.Quantum);
+    //  Keep ticking, so preemption resumes once scheduling is enabled.
+}
+
+/*  Properties  */
+
+Handle Scheduler::SetQuantum(TimeSpanLite const val)
+{
+    InterruptGuard<> intGuard;
+    //  Keeps this code on the same core.
+
+    return SetQuantum(val, Cpu::GetData());
+}
+
+Handle Scheduler::SetQuantum(TimeSpanLite const val, CpuData * const data)
+{
+    if unlikely(data == nullptr)
+        return HandleResult::ArgumentNull;
+    if unlikely(val.Value == 0)
+        return HandleResult::ArgumentOutOfRange;
+
+    data->RunQueue.Quantum = val;
+    //  Takes effect from the next time slice on that core.
+
+    return HandleResult::Okay;
+}
+
+TimeSpanLite Scheduler::GetQuantum()
+{
+    InterruptGuard<> intGuard;
+
+    return Cpu::GetData()->RunQueue.Quantum;
+}
+
+void Scheduler::Idle()
+{
+    Thread * idle = Cpu::GetThread();
+    Thread local {&BootstrapProcess};
+
+    if (idle == nullptr)
+    {
+        //  The core is running on its initial stack, which becomes the stack of
+        //  the idle thread.
+
+        uintptr_t const sp = GetCurrentStackPointer();
+
+        local.KernelStackTop = RoundUp(sp, PageSize);
+        local.KernelStackBottom = RoundDown(sp, PageSize);
+
+        idle = &local;
+    }
+
+    if (Fpu::Eager && idle->ExtendedState == nullptr)
+    {
+        Handle res = ExtendedStates::AllocateNew(idle->ExtendedState);
+
+        ASSERT(res.IsOkayResult()
+            , "Failed to allocate the extended state of an idle thread: %H"
+            , res);
+    }
+    //  Like every other thread, it needs one before being switched.
+
+    withInterrupts (false)
+    {
+        if (idle == &local)
+        {
+            Cpu::SetThread(idle);
+            Cpu::SetProcess(&BootstrapProcess);
+        }
+
+        idle->Pinned = true;
+        //  Another core must never run (and adopt) this core's idle thread.
+
+        Cpu::GetData()->RunQueue.Idle = idle;
+    }
+
+    //  Zero frames ahead of page faults while there is nothing else to do, and
+    //  allow the CPU to rest afterwards.
+    while (true)
+        if (Vmm::PrepareZeroedFrames(ZeroingBatch) == 0 && CpuInstructions::CanHalt)
+            CpuInstructions::Halt();
+}
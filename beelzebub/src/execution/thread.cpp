@@ -38,36 +38,26 @@
 */
 
 #include <execution/thread.hpp>
+#include <execution/extended_states.hpp>
 
 using namespace Beelzebub;
 using namespace Beelzebub::Execution;
 
 /******************
-Thread class
+    Thread class
 *******************/
 
-/*  Linkage  */
+/*  Operations  */
 
-Handle Thread::IntroduceNext(Thread * const other)
+Handle Thread::DisposeExtendedState()
 {
-    Thread * oldNext = this->Next;
+    if (this->ExtendedState == nullptr)
+        return HandleResult::Okay;
 
-    Thread * current = oldNext;
+    Handle res = ExtendedStates::Deallocate(this->ExtendedState);
 
-    do
-    {
-        if (current == other)
-            return HandleResult::ThreadAlreadyLinked;
+    if likely(res.IsOkayResult())
+        this->ExtendedState = nullptr;
 
-        current = current->Next;
-    }
-    while (current != oldNext);
-
-    this->Next = other;
-    oldNext->Previous = other;
-
-    other->Previous = this;
-    other->Next = oldNext;
-
-    return HandleResult::Okay;
+    return res;
 }
@@ -112,7 +112,10 @@ Handle Memory::AcquirePoolInKernelHeap(size_t objectSize
         , MemoryAllocationOptions::Commit | MemoryAllocationOptions::VirtualKernelHeap
         , MemoryFlags::Global | MemoryFlags::Writable
         , MemoryContent::Generic
-        , addr);
+        , addr
+        , size <= ObjectPoolBlockSize ? ObjectPoolBlockSize : PageSize);
+    //  Pools which fit get a block of their own, so the allocator can find
+    //  the pool of an object by masking its address.
 
     if (!res.IsOkayResult())
         return res;
@@ -143,7 +146,17 @@ Handle Memory::EnlargePoolInKernelHeap(size_t objectSize
                                      , ObjectPoolBase * pool)
 {
     size_t const oldSize = RoundUp(objectSize * pool->Capacity + headerSize, PageSize);
-    size_t const newSize = RoundUp(objectSize * (pool->Capacity + minimumExtraObjects) + headerSize, PageSize);
+    size_t newSize = RoundUp(objectSize * (pool->Capacity + minimumExtraObjects) + headerSize, PageSize);
+
+    if (oldSize <= ObjectPoolBlockSize && 0 == ((uintptr_t)pool & (ObjectPoolBlockSize - 1)))
+    {
+        newSize = Minimum(newSize, ObjectPoolBlockSize);
+        //  A pool does not grow out of its block.
+
+        if (newSize <= oldSize)
+            return HandleResult::OutOfMemory;
+        //  The block is full; the allocator will acquire another pool.
+    }
 
     ASSERTX(newSize > oldSize
         , "New size should be larger than the old size of a pool that needs enlarging!%n"
@@ -43,18 +43,22 @@
 
     #include <memory/object_allocator_smp.hpp>
     #include <beel/interrupt.state.hpp>
+    #include <system/cpu.hpp>
+    #include <kernel.hpp>
 
     #include <math.h>
     #include <debug.hpp>
 
     using namespace Beelzebub;
     using namespace Beelzebub::Memory;
+    using namespace Beelzebub::Synchronization;
+    using namespace Beelzebub::System;
 
     #define OBJA_LOCK_TYPE Beelzebub::Synchronization::SmpLockUni
     #define OBJA_COOK_TYPE Beelzebub::InterruptState
 
     #define OBJA_POOL_TYPE      ObjectPoolSmp
-    #define OBJA_ALOC_TYPE      ObjectAllocatorSmp
+    #define OBJA_ALOC_TYPE      ObjectAllocatorSmpBase
     #define OBJA_MULTICONSUMER  true
     #define OBJA_UNINTERRUPTED  true
     #include <memory/object_allocator_cbase.inc>
@@ -66,4 +70,120 @@
     #undef OBJA_COOK_TYPE
     #undef OBJA_LOCK_TYPE
 
+    /*  Magazines  */
+
+    static Atomic<size_t> NextMagazineSlot {0};
+
+    /********************************
+        ObjectAllocatorSmp class
+    ********************************/
+
+    /*  Methods  */
+
+    Handle ObjectAllocatorSmp::AllocateObject(void * & result, size_t estimatedLeft)
+    {
+        if (!this->HasMagazines() || unlikely(!CpuDataSetUp))
+            return this->ObjectAllocatorSmpBase::AllocateObject(result, estimatedLeft);
+
+        InterruptGuard<> intGuard;
+        //  The magazine belongs to this core only while the thread cannot be
+        //  moved to another one.
+
+        ObjectMagazine & mag = Cpu::GetData()->ObjaMagazines[this->MagazineSlot];
+
+        if likely(mag.Count > 0)
+        {
+            result = mag.Objects[--mag.Count];
+
+            return HandleResult::Okay;
+        }
+
+        size_t taken = 0;
+
+        Handle res = this->AllocateObjects(mag.Objects, ObjectMagazine::Batch + 1, taken, estimatedLeft);
+        //  Refill half of the magazine, plus the object that was asked for.
+
+        if unlikely(taken == 0)
+            return res;
+        //  Running out of objects (or quota) after taking some simply means
+        //  the magazine will be emptier.
+
+        result = mag.Objects[taken - 1];
+        mag.Count = taken - 1;
+
+        return HandleResult::Okay;
+    }
+
+    Handle ObjectAllocatorSmp::DeallocateObject(void * const object)
+    {
+        if (!this->HasMagazines() || unlikely(!CpuDataSetUp))
+            return this->ObjectAllocatorSmpBase::DeallocateObject(object);
+
+        InterruptGuard<> intGuard;
+
+        ObjectMagazine & mag = Cpu::GetData()->ObjaMagazines[this->MagazineSlot];
+
+        if unlikely(mag.Count == ObjectMagazine::Capacity)
+        {
+            Handle res = this->DeallocateObjects(mag.Objects, ObjectMagazine::Batch);
+
+            assert(res.IsOkayResult(), "Failed to return objects from a magazine: %H"
+                , res);
+
+            //  The oldest objects are returned, as they are the least likely
+            //  to still be in cache.
+
+            for (size_t i = ObjectMagazine::Batch; i < ObjectMagazine::Capacity; ++i)
+                mag.Objects[i - ObjectMagazine::Batch] = mag.Objects[i];
+
+            mag.Count -= ObjectMagazine::Batch;
+        }
+
+        mag.Objects[mag.Count++] = object;
+
+        return HandleResult::Okay;
+    }
+
+    Handle ObjectAllocatorSmp::EnableMagazines()
+    {
+        if (this->HasMagazines())
+            return HandleResult::Okay;
+
+        size_t const slot = NextMagazineSlot++;
+
+        if unlikely(slot >= ObjectMagazineSlots)
+        {
+            NextMagazineSlot.Store(ObjectMagazineSlots);
+            //  Stop the counter from wrapping around.
+
+            return HandleResult::CardinalityViolation;
+        }
+
+        this->MagazineSlot = slot;
+
+        return HandleResult::Okay;
+    }
+
+    void ObjectAllocatorSmp::FlushMagazine()
+    {
+        if (!this->HasMagazines() || unlikely(!CpuDataSetUp))
+            return;
+
+        InterruptGuard<> intGuard;
+
+        ObjectMagazine & mag = Cpu::GetData()->ObjaMagazines[this->MagazineSlot];
+
+        this->DeallocateObjects(mag.Objects, mag.Count);
+        mag.Count = 0;
+    }
+
+    void ObjectAllocatorSmp::Dispose()
+    {
+        assert(!this->HasMagazines()
+            , "Object allocator %Xp cannot be disposed, for it has magazines on every core."
+            , this);
+
+        this->ObjectAllocatorSmpBase::Dispose();
+    }
+
 #endif
@@ -121,6 +121,27 @@ namespace Beelzebub { namespace Utils
     COMP_FORWARD_TWO_WAY(MemoryRegion, vaddr_t, MemoryRange, vaddr_t, GET_REGION_RANGE, MCATS1)
 }}
 
+/*****************
+    Augmentation
+*****************/
+
+namespace Beelzebub { namespace Utils
+{
+    void AugmentNode(AvlTreeNode<MemoryRegion> * const node)
+    {
+        vsize_t gap = node->Payload.Content == MemoryContent::Free
+            ? node->Payload.GetSize() : 0;
+
+        if (node->Left != nullptr)
+            gap = Maximum(gap, node->Left->Payload.FreeGap);
+
+        if (node->Right != nullptr)
+            gap = Maximum(gap, node->Right->Payload.FreeGap);
+
+        node->Payload.FreeGap = gap;
+    }
+}}
+
 /************************
     TERMINAL PRINTING
 ************************/
@@ -41,6 +41,8 @@
 
 #include "memory/vas.hpp"
 #include <beel/interrupt.state.hpp>
+#include <system/cpu_instructions.hpp>
+#include <kernel.hpp>
 
 #include <debug.hpp>
 
@@ -51,6 +53,7 @@
 using namespace Beelzebub;
 using namespace Beelzebub::Memory;
 using namespace Beelzebub::Synchronization;
+using namespace Beelzebub::System;
 using namespace Beelzebub::Utils;
 
 struct DescriptorCheckResults
@@ -96,6 +99,28 @@ struct OperationParameters
     //  Meant to change `Address` if the check passes.
     virtual bool CanAllocateAnonymously(MemoryRegion * reg) = 0;
 
+    //  Finds the lowest free region in the given subtree which is large enough
+    //  and passes `CanAllocateAnonymously`. Subtrees without a large enough
+    //  free gap are skipped entirely.
+    MemoryRegion * FindAnonymousFit(AvlTree<MemoryRegion>::Node * const node)
+    {
+        if (node == nullptr || node->Payload.FreeGap < this->StartSize)
+            return nullptr;
+
+        MemoryRegion * reg = this->FindAnonymousFit(node->Left);
+
+        if (reg != nullptr)
+            return reg;
+
+        reg = &(node->Payload);
+
+        if (reg->Content == MemoryContent::Free && reg->GetSize() >= this->StartSize
+            && this->CanAllocateAnonymously(reg))
+            return reg;
+
+        return this->FindAnonymousFit(node->Right);
+    }
+
     /*  Fields  */
 
     Memory::Vas * const Vas;
@@ -141,34 +166,19 @@ struct OperationParameters
         {
             cookie = InterruptState::Disable();
 
-            vas->Lock.AcquireAsWriter();
+            vas->AcquireAsWriter();
         }
 
         if unlikely(this->Allocation && vaddr == nullvaddr)
         {
             //  Null vaddr on allocation means any address is accepted.
 
-            reg = vas->First;
-
-            do
-            {
-                if (reg->Content == MemoryContent::Free && this->CanAllocateAnonymously(reg))
-                {
-                    //  This free region fits the criteria for anonymous allocation.
-
-                    res = this->Execute(false);
-
-                    goto end;
-                }
-
-                //  If not, move on.
-
-                reg = reg->Next;
-            } while (reg != nullptr);
-
-            //  Reaching this point means there is no space to spare!
-
-            res = HandleResult::OutOfMemory;
+            if (this->FindAnonymousFit(vas->Tree.Root) != nullptr)
+                res = this->Execute(false);
+                //  A free region fits the criteria for anonymous allocation.
+            else
+                res = HandleResult::OutOfMemory;
+                //  No space to spare!
 
             goto end;
         }
@@ -207,9 +217,6 @@ struct OperationParameters
             goto end;
         }
 
-        if (vas->LastSearched == reg)
-            vas->LastSearched = nullptr;
-
         if (endAddr > reg->Range.End)
         {
             if (this->Sparse)
@@ -280,6 +287,7 @@ struct OperationParameters
                         //  Now there's room to expand the previous descriptor, which is in `reg`.
 
                         reg->Range.End = newEnd;
+                        vas->Tree.Refresh<vaddr_t>(reg->Range.Start);
 
                         if ((reg->Next = next) != nullptr)
                             next->Prev = reg;
@@ -307,6 +315,7 @@ struct OperationParameters
                             //  Now there's room to expand the next descriptor.
 
                             reg->Range.Start = newStart;
+                            vas->Tree.Refresh<vaddr_t>(newStart);
 
                             if ((reg->Prev = prev) != nullptr)
                                 prev->Next = reg;
@@ -324,6 +333,7 @@ struct OperationParameters
                             //  Therefore, no removal is necessary, just repurposing.
 
                             this->Repurpose(reg);
+                            vas->Tree.Refresh<vaddr_t>(vaddr);
 
                             //  And linkage stays intact.
 
@@ -345,12 +355,15 @@ struct OperationParameters
                     reg->Type &= ~MemoryAllocationOptions::GuardLow;
                     //  Chosen descriptor is shrunk and lower guard is gone, if any.
 
+                    vas->Tree.Refresh<vaddr_t>(endAddr);
+
                     if (dcr.LeftMergeable)
                     {
                         //  Left descriptor is mergeable means it can be extended to
                         //  cover the operated parts.
 
                         reg->Prev->Range.End = endAddr;
+                        vas->Tree.Refresh<vaddr_t>(oldStart);
 
                         //  Linkage is intact.
 
@@ -398,12 +411,15 @@ struct OperationParameters
                     reg->Type &= ~MemoryAllocationOptions::GuardHigh;
                     //  Busy descriptor is shrunk and higher guard is gone, if any.
 
+                    vas->Tree.Refresh<vaddr_t>(reg->Range.Start);
+
                     if (dcr.RightMergeable)
                     {
                         //  Next descriptor is mergeable means it can be extended to
                         //  cover the operated parts.
 
                         reg->Next->Range.Start = vaddr;
+                        vas->Tree.Refresh<vaddr_t>(vaddr);
 
                         //  Linkage is intact.
 
@@ -452,6 +468,7 @@ struct OperationParameters
                     //  Remove high guard, if there was any.
 
                     reg->Range.End = vaddr;
+                    vas->Tree.Refresh<vaddr_t>(reg->Range.Start);
 
                     MemoryRegion * newMidReg = nullptr, * newEndReg = nullptr;
 
@@ -501,7 +518,7 @@ struct OperationParameters
 
         if likely(lock)
         {
-            vas->Lock.ReleaseAsWriter();
+            vas->ReleaseAsWriter();
 
             cookie.Restore();
         }
@@ -516,11 +533,18 @@ struct OperationParameters
 
 /*  Constructors  */
 
+static Atomic<uint64_t> NextSequenceBase {0};
+
 Handle Vas::Initialize(vaddr_t start, vaddr_t end
     , AcquirePoolFunc acquirer, EnlargePoolFunc enlarger, ReleasePoolFunc releaser
     , PoolReleaseOptions const releaseOptions
     , size_t const quota)
 {
+    this->Sequence.Store(NextSequenceBase.FetchAdd((uint64_t)1 << 32));
+    //  Regions are cached per core by address space and sequence number. An
+    //  address space made anew where another one used to be must not match
+    //  what was cached for the old one.
+
     new (&(this->Alloc)) ObjectAllocator(
         sizeof(*(this->Tree.Root)), __alignof(*(this->Tree.Root)),
         acquirer, enlarger, releaser, releaseOptions, SIZE_MAX, quota);
@@ -536,13 +560,38 @@ Handle Vas::Initialize(vaddr_t start, vaddr_t end
 
 Handle Vas::Allocate(vaddr_t & vaddr, size_t size
     , MemoryFlags flags, MemoryContent content
-    , MemoryAllocationOptions type, bool lock)
+    , MemoryAllocationOptions type, bool lock, vsize_t alignment)
 {
     if unlikely(this->First == nullptr)
         return HandleResult::ObjectDisposed;
 
+    if unlikely(alignment < PageSize || 0 != (alignment & (alignment - 1)))
+        return HandleResult::AlignmentFailure;
+    //  Only powers of two are accepted.
+
     Handle res;
 
+    switch (type & MemoryAllocationOptions::AlignmentMask)
+    {
+    case MemoryAllocationOptions::None:
+        break;
+    case MemoryAllocationOptions::Align2MiB:
+        alignment = Maximum(alignment, LargePageSize);
+        break;
+    case MemoryAllocationOptions::Align1GiB:
+        alignment = Maximum(alignment, (vsize_t)1 << 30);
+        break;
+
+    default:
+        return HandleResult::ArgumentOutOfRange;
+    }
+
+    if unlikely(vaddr != nullvaddr && vaddr % alignment != 0)
+        return HandleResult::AlignmentFailure;
+
+    type &= ~MemoryAllocationOptions::AlignmentMask;
+    //  The alignment only matters for finding a place; regions keep the rest.
+
     size_t const lowOffset  = 0 != (type & MemoryAllocationOptions::GuardLow ) ? PageSize : 0;
     size_t const highOffset = 0 != (type & MemoryAllocationOptions::GuardHigh) ? PageSize : 0;
 
@@ -554,11 +603,14 @@ Handle Vas::Allocate(vaddr_t & vaddr, size_t size
         /*  Constructor(s)  */
 
         inline AllocateOperation(Memory::Vas * vas, vaddr_t vaddr, size_t size
-                               , MemoryFlags flags, MemoryContent content, MemoryAllocationOptions type)
+                               , MemoryFlags flags, MemoryContent content, MemoryAllocationOptions type
+                               , vsize_t alignment, size_t lowOffset)
             : OperationParameters(vas, vaddr, size, false, false, true)
             , Flags(flags)
             , Content(content)
             , Type(type)
+            , Alignment(alignment)
+            , LowOffset(lowOffset)
         {
 
         }
@@ -614,14 +666,20 @@ Handle Vas::Allocate(vaddr_t & vaddr, size_t size
 
         virtual bool CanAllocateAnonymously(MemoryRegion * reg) override
         {
-            //  TODO: Alignment rules.
+            if (reg->GetSize() < this->StartSize)
+                return false;
 
-            bool res = reg->GetSize() >= this->StartSize;
+            vaddr_t const usable = RoundDown(reg->Range.End - this->StartSize + this->LowOffset
+                , this->Alignment);
+            //  The usable part (after the low guard) is aligned, as high as it
+            //  can go within the region.
 
-            if (res)
-                this->Address = reg->Range.End - this->StartSize;
+            if (usable < reg->Range.Start + this->LowOffset)
+                return false;
 
-            return res;
+            this->Address = usable - this->LowOffset;
+
+            return true;
         }
 
         /*  Fields  */
@@ -629,12 +687,20 @@ Handle Vas::Allocate(vaddr_t & vaddr, size_t size
         MemoryFlags Flags;
         MemoryContent Content;
         MemoryAllocationOptions Type;
-    } manip(this, effectiveAddress, effectiveSize, flags, content, type);
+
+        vsize_t Alignment;
+        size_t LowOffset;
+    } manip(this, effectiveAddress, effectiveSize, flags, content, type, alignment, lowOffset);
 
     res = manip.Execute(lock);
 
     vaddr = manip.Address + lowOffset;
 
+    if likely(res.IsOkayResult())
+        this->WaitForRange(manip.Address, manip.Address + effectiveSize);
+    //  The pages of a recent release of this range may still be on their way
+    //  out.
+
     return res;
 }
 
@@ -715,7 +781,7 @@ Handle Vas::Modify(vaddr_t vaddr, size_t pageCnt
     {
         cookie = InterruptState::Disable();
 
-        this->Lock.AcquireAsWriter();
+        this->AcquireAsWriter();
     }
 
     //  So, this is gonna suck a bit. There are... Lots of options.
@@ -723,7 +789,7 @@ Handle Vas::Modify(vaddr_t vaddr, size_t pageCnt
 //end:
     if likely(lock)
     {
-        this->Lock.ReleaseAsWriter();
+        this->ReleaseAsWriter();
 
         cookie.Restore();
     }
@@ -731,6 +797,44 @@ Handle Vas::Modify(vaddr_t vaddr, size_t pageCnt
     return res;
 }
 
+Handle Vas::Clone(Vas const & source)
+{
+    if unlikely(this->First == nullptr || source.First == nullptr)
+        return HandleResult::ObjectDisposed;
+
+    for (MemoryRegion const * reg = source.First; reg != nullptr; reg = reg->Next)
+    {
+        if (reg->Content == MemoryContent::Free)
+            continue;
+
+        size_t const lowOffset  = 0 != (reg->Type & MemoryAllocationOptions::GuardLow ) ? PageSize : 0;
+        size_t const highOffset = 0 != (reg->Type & MemoryAllocationOptions::GuardHigh) ? PageSize : 0;
+        //  Guard pages are added back by the allocation.
+
+        vaddr_t vaddr = reg->Range.Start + lowOffset;
+
+        Handle res = this->Allocate(vaddr, reg->Range.GetSize() - lowOffset - highOffset
+            , reg->Flags, reg->Content, reg->Type);
+
+        if unlikely(!res.IsOkayResult())
+            return res;
+    }
+
+    return HandleResult::Okay;
+}
+
+void Vas::Dispose()
+{
+    this->Tree.Root = nullptr;
+    this->First = nullptr;
+    //  Any further operation fails.
+
+    this->Sequence += 2;
+    //  Neither may cached regions be found anymore.
+
+    this->Alloc.Dispose();
+}
+
 MemoryRegion * Vas::FindRegion(vaddr_t vaddr)
 {
 #ifdef DEBUG_MEMORY_CORRUPTION
@@ -762,6 +866,157 @@ MemoryRegion * Vas::FindRegion(vaddr_t vaddr)
 #endif
 }
 
+struct LastRegionCache
+{
+    Vas const * Owner;
+    uint64_t Sequence;
+
+    vaddr_t Start, End;
+    MemoryFlags Flags;
+    MemoryContent Content;
+    MemoryAllocationOptions Type;
+};
+
+static __thread LastRegionCache LastRegion;
+
+bool Vas::TryFindRegion(vaddr_t vaddr, MemoryRegion & reg, uint64_t & seq) const
+{
+    seq = this->Sequence.Load(MemoryOrder::Acquire);
+
+    if unlikely(0 != (seq & 1))
+        return false;
+    //  A writer is at work.
+
+    if likely(CpuDataSetUp)
+    {
+        LastRegionCache const & cache = LastRegion;
+
+        if (cache.Owner == this && cache.Sequence == seq
+            && vaddr >= cache.Start && vaddr < cache.End)
+        {
+            reg = MemoryRegion(cache.Start, cache.End, cache.Flags, cache.Content, cache.Type);
+
+            return true;
+        }
+    }
+
+    AvlTree<MemoryRegion>::Node const * node = this->Tree.Root;
+
+    while (true)
+    {
+        if unlikely(this->HasChangedSince(seq))
+            return false;
+        //  A pointer is only followed if no writer has started since, so it
+        //  still points to a node. Node memory is never given back, so reading
+        //  a node which is removed meanwhile is harmless.
+
+        if (node == nullptr)
+        {
+            reg = MemoryRegion();
+
+            return true;
+        }
+
+        vaddr_t const start = node->Payload.Range.Start, end = node->Payload.Range.End;
+
+        if (vaddr < start)
+            node = node->Left;
+        else if (vaddr >= end)
+            node = node->Right;
+        else
+            break;
+    }
+
+    reg = node->Payload;
+    reg.Next = reg.Prev = nullptr;
+    //  The copy is detached from the list.
+
+    if unlikely(this->HasChangedSince(seq))
+        return false;
+
+    if likely(CpuDataSetUp)
+        LastRegion = { this, seq, reg.Range.Start, reg.Range.End
+                     , reg.Flags, reg.Content, reg.Type };
+
+    return true;
+}
+
+/*  Range Locking  */
+
+void Vas::LockRange(vaddr_t const start, vaddr_t const end)
+{
+    MemoryRange const range {start, end};
+
+    while (true)
+    {
+        withLock (this->RangesLock)
+        {
+            MemoryRange * slot = nullptr;
+            bool overlaps = false;
+
+            for (size_t i = 0; i < RangeLockCount; ++i)
+                if (!this->LockedRanges[i].IsValid())
+                {
+                    if (slot == nullptr)
+                        slot = this->LockedRanges + i;
+                }
+                else if ((this->LockedRanges[i] & range).IsValid())
+                    overlaps = true;
+
+            if (!overlaps && slot != nullptr)
+            {
+                *slot = range;
+
+                return;
+            }
+        }
+
+        withInterrupts (true)
+            CpuInstructions::DoNothing();
+        //  The holder may have been preempted on this core, so it can only make
+        //  progress if interrupts are let through while waiting. Callers which
+        //  keep them disabled, like pool releases, get them back disabled.
+    }
+}
+
+void Vas::UnlockRange(vaddr_t const start, vaddr_t const end)
+{
+    MemoryRange const range {start, end};
+
+    withLock (this->RangesLock)
+        for (size_t i = 0; i < RangeLockCount; ++i)
+            if (this->LockedRanges[i] == range)
+            {
+                this->LockedRanges[i] = MemoryRange::Invalid;
+
+                return;
+            }
+
+    FAIL("Unlocking VAS range %Xp-%Xp which is not locked.", start, end);
+}
+
+void Vas::WaitForRange(vaddr_t const start, vaddr_t const end)
+{
+    MemoryRange const range {start, end};
+
+    while (true)
+    {
+        bool overlaps = false;
+
+        withLock (this->RangesLock)
+            for (size_t i = 0; i < RangeLockCount; ++i)
+                if (this->LockedRanges[i].IsValid() && (this->LockedRanges[i] & range).IsValid())
+                    overlaps = true;
+
+        if (!overlaps)
+            return;
+
+        withInterrupts (true)
+            CpuInstructions::DoNothing();
+        //  Same as in LockRange.
+    }
+}
+
 /*  Support  */
 
 Handle Vas::AllocateNode(AvlTree<MemoryRegion>::Node * & node)
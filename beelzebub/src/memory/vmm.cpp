@@ -65,6 +65,201 @@ static __forceinline bool Is4KiBAligned(TInt val) { return (val & (     PageSize
 template<typename TInt>
 static __forceinline bool Is2MiBAligned(TInt val) { return (val & (LargePageSize - 1)) == 0; }
 
+/**
+ *  Determines whether the large page starting at the given address can back
+ *  the given on-demand region, without covering its guard pages.
+ */
+static __forceinline bool FitsLargePage(MemoryRegion const * reg, vaddr_t const vaddr)
+{
+    vaddr_t start = reg->Range.Start, end = reg->Range.End;
+
+    if (0 != (reg->Type & MemoryAllocationOptions::GuardLow))
+        start += PageSize;
+    if (0 != (reg->Type & MemoryAllocationOptions::GuardHigh))
+        end -= PageSize;
+
+    return vaddr >= start && vaddr + LargePageSize <= end;
+}
+
+/**
+ *  Fills a frame which is about to back userland pages allocated on demand.
+ *  This cannot wait until the frame is mapped, because a clone of the process
+ *  may share it from that moment on.
+ */
+static __hot Handle ClearDemandFrame(paddr_t const frame, size_t const size, MemoryFlags const flags)
+{
+    //  This was a request in userland, therefore the page contents need to
+    //  be TERMINATED.
+
+    uint8_t const fill = 0 != (flags & MemoryFlags::Writable) ? 0x00 : 0xCA;
+    //  Read-only pages are all CACA! They shouldn't be read, they should be
+    //  written to using a syscall.
+
+    Handle res = HandleResult::Okay;
+
+    for (size_t offset = 0; offset < size && res == HandleResult::Okay; offset += PageSize)
+        res = Vmm::FillFrame(frame + offset, nullptr, fill);
+
+    return res;
+}
+
+/**
+ *  The frame which backs untouched demand-allocated userland pages until they
+ *  are written to. It keeps one reference of its own, so it is never freed.
+ */
+static paddr_t ZeroFrame = nullpaddr;
+
+static __hot paddr_t GetZeroFrame()
+{
+    paddr_t frame = __atomic_load_n(&ZeroFrame, __ATOMIC_ACQUIRE);
+
+    if likely(frame != nullpaddr)
+        return frame;
+
+    frame = Pmm::AllocateFrame(1);
+
+    if unlikely(frame == nullpaddr)
+        return nullpaddr;
+
+    paddr_t expected = nullpaddr;
+
+    if unlikely(Vmm::FillFrame(frame, nullptr) != HandleResult::Okay
+             || !__atomic_compare_exchange_n(&ZeroFrame, &expected, frame
+                , false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        Pmm::FreeFrame(frame);
+
+        return expected;
+    }
+
+    return frame;
+}
+
+/**
+ *  Gives the faulting thread a private copy of a page it wrote to, unless it
+ *  already holds the only reference to the frame.
+ */
+static __hot Handle CopyOnWrite(Process * proc, vaddr_t const vaddr, MemoryFlags const flags)
+{
+    paddr_t old;
+    Handle res = Vmm::Translate(proc, vaddr, old);
+
+    if unlikely(res == HandleResult::PageUnmapped)
+        return HandleResult::Okay;
+    //  Unmapped meanwhile; the retried access will fault again if need be.
+    else if unlikely(res != HandleResult::Okay)
+        return res;
+
+    bool const zero = old == ZeroFrame;
+    FrameSize size = FrameSize::_4KiB;
+
+    if (!zero)
+    {
+        uint32_t refCnt;
+
+        res = Pmm::GetFrameInfo(old, size, refCnt);
+
+        if unlikely(res != HandleResult::Okay)
+            return res;
+
+        if (refCnt == 1)
+        {
+            res = Vmm::ClaimPage(proc, vaddr, old, flags);
+
+            if (res != HandleResult::PageMapped)
+                return res;
+            //  Nobody else shares it anymore, unless a clone took it meanwhile.
+
+            res = HandleResult::Okay;
+        }
+    }
+
+    vaddr_t const base = size == FrameSize::_2MiB ? RoundDown(vaddr, LargePageSize) : vaddr;
+    size_t const pageCount = size == FrameSize::_2MiB ? LargePageSize / PageSize : 1;
+    //  Large pages shared by cloned processes are copied whole.
+
+    paddr_t frame = zero ? Pmm::AllocateZeroedFrame() : nullpaddr;
+
+    if (frame == nullpaddr)
+    {
+        frame = Pmm::AllocateFrame(size);
+
+        if unlikely(frame == nullpaddr)
+            return HandleResult::OutOfMemory;
+
+        for (size_t i = 0; i < pageCount && res == HandleResult::Okay; ++i)
+            res = Vmm::FillFrame(frame + i * PageSize
+                , zero ? nullptr : reinterpret_cast<void const *>(base + i * PageSize));
+
+        if unlikely(res != HandleResult::Okay)
+        {
+            Pmm::FreeFrame(frame);
+
+            return res;
+        }
+    }
+
+    res = Vmm::ReplacePage(proc, base, old, frame, flags);
+
+    if unlikely(res != HandleResult::Okay)
+    {
+        Pmm::FreeFrame(frame);
+
+        if (res == HandleResult::PageMapped)
+            return HandleResult::Okay;
+        //  Another thread copied it first.
+    }
+
+    return res;
+}
+
+/**
+ *  Ends the handling of a page fault. Without the lock, pages which were mapped
+ *  while the VAS changed are checked again, and taken out if their region is
+ *  gone. Returns false in that case.
+ */
+static __hot bool FinishFault(Process * proc, Memory::Vas * vas, MemoryRegion const * snap
+    , bool const locked, uint64_t const seq, vaddr_t const vaddr, size_t const size)
+{
+    if (locked)
+    {
+        vas->Lock.ReleaseAsReader();
+
+        return true;
+    }
+
+    if likely(size == 0 || !vas->HasChangedSince(seq))
+        return true;
+
+    vas->Lock.AcquireAsReader();
+
+    MemoryRegion const * const reg = vas->FindRegion(vaddr);
+
+    vaddr_t start = 0, end = 0;
+
+    if likely(reg != nullptr && reg->Flags == snap->Flags && reg->Content == snap->Content
+        && (reg->Type & MemoryAllocationOptions::StrategyMask) == MemoryAllocationOptions::AllocateOnDemand)
+    {
+        start = reg->Range.Start;
+        end = reg->Range.End;
+
+        if (0 != (reg->Type & MemoryAllocationOptions::GuardLow))
+            start += PageSize;
+        if (0 != (reg->Type & MemoryAllocationOptions::GuardHigh))
+            end -= PageSize;
+    }
+
+    bool const valid = vaddr >= start && vaddr + size <= end;
+
+    if unlikely(!valid)
+        Vmm::UnmapRange(proc, vaddr, size);
+    //  Nobody else can map anything in there while the lock is held.
+
+    vas->Lock.ReleaseAsReader();
+
+    return valid;
+}
+
 /****************
     Vmm class
 ****************/
@@ -82,9 +277,12 @@ Handle Vmm::HandlePageFault(Execution::Process * proc
 {
     //  Assumes interrupts are disabled upon call.
 
-    if unlikely(0 != (flags & PageFaultFlags::Present))
+    bool const present = 0 != (flags & PageFaultFlags::Present);
+
+    if unlikely(present && (0 == (flags & PageFaultFlags::Write) || vaddr >= Vmm::UserlandEnd))
         return HandleResult::Failed;
-    //  Page is present. This means this is an access (write/execute) failure.
+    //  Page is present. This means this is an access (write/execute) failure,
+    //  unless it is a write to a userland page shared until written to.
 
     if unlikely(!((vaddr >= Vmm::UserlandStart && vaddr <= Vmm::UserlandEnd)
                || (vaddr >= Vmm::KernelStart   && vaddr <= Vmm::KernelEnd  )))
@@ -98,8 +296,13 @@ Handle Vmm::HandlePageFault(Execution::Process * proc
 
     paddr_t paddr;
 
-    vaddr_t const vaddr_algn = RoundDown(vaddr, PageSize);
-    MemoryRegion * reg;
+    vaddr_t vaddr_algn = RoundDown(vaddr, PageSize);
+    vaddr_t const vaddr_large = RoundDown(vaddr, LargePageSize);
+    size_t size = PageSize;
+    bool zeroed = false;
+    MemoryRegion region;
+    MemoryRegion const * const reg = &region;
+    uint64_t seq;
 
     if unlikely(vaddr >= Vmm::KernelStart)
     {
@@ -108,28 +311,32 @@ Handle Vmm::HandlePageFault(Execution::Process * proc
             ("enlarger", KVas.EnlargingCore)XEND;
     }
 
-    vas->Lock.AcquireAsReader();
-
-#define RETURN(HRES) do { res = HandleResult::HRES; goto end; } while (false)
+    bool const locked = !vas->TryFindRegion(vaddr, region, seq);
+    //  The region is looked up without the lock, unless a writer is in the way.
 
-    if (vas->LastSearched != nullptr && vas->LastSearched->Contains(vaddr))
-        reg = vas->LastSearched;
-        //  No need to check whether anything can be allocated in the page or not.
-    else
+    if unlikely(locked)
     {
-        reg = vas->FindRegion(vaddr);
+        vas->Lock.AcquireAsReader();
 
-        if unlikely( reg == nullptr
-                 || reg->Content == MemoryContent::Free)
-            RETURN(ArgumentOutOfRange);
-        //  Either of these conditions means this page fault was caused by a hit on
-        //  unallocated/freed memory.
+        MemoryRegion const * const found = vas->FindRegion(vaddr);
 
-        if unlikely((reg->Type & MemoryAllocationOptions::StrategyMask) != MemoryAllocationOptions::AllocateOnDemand)
-            RETURN(PageUndemandable);
-        //  Regions which aren't allocated on demand aren't covered by this handler.
+        if (found != nullptr)
+            region = *found;
     }
 
+#define RETURN(HRES) do { res = HandleResult::HRES; goto end; } while (false)
+
+    if unlikely(!reg->IsValid()
+             || reg->Content == MemoryContent::Free)
+        RETURN(ArgumentOutOfRange);
+    //  Either of these conditions means this page fault was caused by a hit on
+    //  unallocated/freed memory.
+
+    if unlikely(!present
+        && (reg->Type & MemoryAllocationOptions::StrategyMask) != MemoryAllocationOptions::AllocateOnDemand)
+        RETURN(PageUndemandable);
+    //  Regions which aren't allocated on demand aren't covered by this handler.
+
     if unlikely((0 != (reg->Type & MemoryAllocationOptions::GuardLow ) && vaddr_algn <  (reg->Range.Start + PageSize))
              || (0 != (reg->Type & MemoryAllocationOptions::GuardHigh) && vaddr_algn >= (reg->Range.End   - PageSize)))
         RETURN(PageGuard);
@@ -141,20 +348,156 @@ Handle Vmm::HandlePageFault(Execution::Process * proc
     //  So this was either an attempt to execute a non-executable page, or to
     //  access (in any way) a supervisor page from userland.
 
+    if (present)
+    {
+        if unlikely(0 == (reg->Flags & MemoryFlags::Writable))
+            RETURN(Failed);
+        //  Actually read-only.
+
+        res = CopyOnWrite(proc, vaddr_algn, reg->Flags);
+
+        goto end;
+    }
+
     //  Reaching this point means this page is meant to be allocated.
 
-    vas->LastSearched = reg;
-    //  Make the next operation potentially faster. This is done even if the
-    //  following allocation fails, because it doesn't affect the correctness of
-    //  the VAS.
+    if (0 == (flags & (PageFaultFlags::Write | PageFaultFlags::Execute))
+        && vaddr < Vmm::KernelStart && 0 != (reg->Flags & MemoryFlags::Writable)
+        && (paddr = GetZeroFrame()) != nullpaddr)
+    {
+        //  Reads of untouched memory all see the same zeros, so no frame is
+        //  spent until the first write.
+
+        res = Vmm::MapPage(proc, vaddr_algn, paddr, reg->Flags & ~MemoryFlags::Writable);
+
+        if likely(res == HandleResult::Okay)
+            goto mapped;
+
+        if (res == HandleResult::PageMapped)
+            res = HandleResult::Okay;
+
+        goto end;
+    }
+
+    if (vaddr < Vmm::KernelStart && FitsLargePage(reg, vaddr_large))
+    {
+        //  The whole surrounding large page belongs to this region, so it is
+        //  backed by a single large frame, sparing 511 more faults.
+
+        paddr = Pmm::AllocateFrame(FrameSize::_2MiB);
+
+        if likely(paddr != nullpaddr)
+        {
+            res = ClearDemandFrame(paddr, LargePageSize, reg->Flags);
+
+            if likely(res == HandleResult::Okay)
+                res = Vmm::MapPage(proc, vaddr_large, paddr, FrameSize::_2MiB, reg->Flags);
+
+            if likely(res == HandleResult::Okay)
+            {
+                vaddr_algn = vaddr_large;
+                size = LargePageSize;
+
+                goto mapped;
+            }
+
+            Pmm::FreeFrame(paddr);
+        }
+
+        if (Vmm::Translate(proc, vaddr, paddr) == HandleResult::Okay)
+            RETURN(Okay);
+        //  Another core may have mapped this page meanwhile, possibly as part
+        //  of the very same large page, which leaves no room for a small one.
+
+        //  Small frames may still be available when large ones are not.
+    }
+    else if (0 != (reg->Type & MemoryAllocationOptions::FaultAround) && Vmm::FaultAroundPages > 1)
+    {
+        //  The neighbouring pages are populated along with this one, in one
+        //  pass over the paging tables.
+
+        size_t const window = Minimum(Vmm::FaultAroundPages, (size_t)64) * PageSize;
+
+        vaddr_t start = vaddr_large + (vaddr_algn - vaddr_large) / window * window;
+        vaddr_t end = Minimum(start + window, vaddr_large + LargePageSize);
+        //  The window never crosses a large page boundary.
 
-    paddr = Pmm::AllocateFrame();
+        if (0 != (reg->Type & MemoryAllocationOptions::GuardLow))
+            start = Maximum(start, reg->Range.Start + PageSize);
+        else
+            start = Maximum(start, reg->Range.Start);
+
+        if (0 != (reg->Type & MemoryAllocationOptions::GuardHigh))
+            end = Minimum(end, reg->Range.End - PageSize);
+        else
+            end = Minimum(end, reg->Range.End);
+
+        size_t const count = (end - start) / PageSize;
+        paddr_t frames[64];
+
+        size_t const n = Pmm::AllocateFrames(frames, count);
+
+        if likely(n == count)
+        {
+            uint64_t mapped = 0;
+
+            res = HandleResult::Okay;
+
+            if likely(vaddr < KernelStart)
+                for (size_t i = 0; i < count && res == HandleResult::Okay; ++i)
+                    res = ClearDemandFrame(frames[i], PageSize, reg->Flags);
+
+            if likely(res == HandleResult::Okay)
+                res = Vmm::MapPages(proc, start, frames, count, reg->Flags, mapped);
+
+            for (size_t i = 0; i < count; ++i)
+                if (0 == (mapped & (1ULL << i)))
+                    Pmm::FreeFrame(frames[i]);
+            //  Pages mapped in the meantime keep their frames.
+
+            if likely(res == HandleResult::Okay || res == HandleResult::PageMapped)
+            {
+                //  Either way, the faulting page is mapped now.
+
+                FinishFault(proc, vas, reg, locked, seq, start, end - start);
+
+                return HandleResult::Okay;
+            }
+
+            //  Nothing was mapped, so the faulting page is tried on its own.
+        }
+        else
+        {
+            for (size_t i = 0; i < n; ++i)
+                Pmm::FreeFrame(frames[i]);
+            //  Memory is tight, so only the faulting page gets a frame.
+        }
+    }
+
+    if (vaddr < Vmm::KernelStart && 0 != (reg->Flags & MemoryFlags::Writable)
+        && (paddr = Pmm::AllocateZeroedFrame()) != nullpaddr)
+        zeroed = true;
+        //  Idle cores have already done the clearing.
+    else
+        paddr = Pmm::AllocateFrame();
 
     if unlikely(paddr == nullpaddr)
         RETURN(OutOfMemory);
     //  Okay... Out of memory... Bad.
     //  TODO: Handle this.
 
+    if (vaddr < Vmm::KernelStart && !zeroed)
+    {
+        res = ClearDemandFrame(paddr, PageSize, reg->Flags);
+
+        if unlikely(res != HandleResult::Okay)
+        {
+            Pmm::FreeFrame(paddr);
+
+            goto end;
+        }
+    }
+
     //  Right now, the page is categorically unmapped.
 
     res = Vmm::MapPage(proc, vaddr_algn, paddr, reg->Flags);
@@ -168,41 +511,65 @@ Handle Vmm::HandlePageFault(Execution::Process * proc
         //  Get rid of the physical page if mapping failed. :frown:
     }
 
-    vas->Lock.ReleaseAsReader();
-
+mapped:
     // MSG_("Allocated on demand page %XP at %Xp.%n", paddr, vaddr_algn);
 
-    if likely(res == HandleResult::Okay)
-    {
-        if likely(vaddr < KernelStart)
-        {
-            //  This was a request in userland, therefore the page contents need to
-            //  be TERMINATED.
-
-            if (0 != (reg->Flags & MemoryFlags::Writable))
-                memset(reinterpret_cast<void *>(vaddr_algn), 0, PageSize);
-                //  This is allowed.
-            else
-                withWriteProtect (false)
-                    memset(reinterpret_cast<void *>(vaddr_algn), 0xCA, PageSize);
-                //  It's all CACA! It shouldn't be read, it should be written to using
-                //  a syscall.
-        }
-        // else
-        // {
-        //     ASSERTX(0 != (reg->Flags & MemoryFlags::Writable)
-        //         , "Kernel should not request read-only pages allocated on demand!")XEND;
-
-        //     memset(reinterpret_cast<void *>(vaddr_algn), 0, PageSize);
-        // }
-    }
+    FinishFault(proc, vas, reg, locked, seq, vaddr_algn
+        , res == HandleResult::Okay ? size : 0);
 
     return HandleResult::Okay;
     //  Even if it was PageMapped!
 
 #undef RETURN
 end:
-    vas->Lock.ReleaseAsReader();
+    FinishFault(proc, vas, reg, locked, seq, vaddr_algn, 0);
+
+    return res;
+}
+
+Handle Vmm::UnsharePages(Execution::Process * proc
+    , uintptr_t const vaddr, size_t const size)
+{
+    if (proc == nullptr) proc = likely(Cores::IsReady()) ? Cpu::GetProcess() : &BootstrapProcess;
+
+    Handle res = HandleResult::Okay;
+    vaddr_t const end = vaddr + size;
+
+    for (vaddr_t page = RoundDown(vaddr, PageSize); page < end && res == HandleResult::Okay; page += PageSize)
+    {
+        paddr_t paddr;
+
+        res = Vmm::Translate(proc, page, paddr);
+
+        if (res == HandleResult::PageUnmapped)
+        {
+            res = Vmm::HandlePageFault(proc, page, PageFaultFlags::Write | PageFaultFlags::Userland);
+            //  Pages allocated now get private frames.
+
+            continue;
+        }
+        else if unlikely(res != HandleResult::Okay)
+            break;
+
+        FrameSize frameSize;
+        uint32_t refCnt;
+
+        if (paddr != ZeroFrame
+            && (Pmm::GetFrameInfo(paddr, frameSize, refCnt) != HandleResult::Okay || refCnt == 1))
+            continue;
+        //  Frames outside of the allocator are never shared copy-on-write.
+
+        proc->Vas.Lock.AcquireAsReader();
+
+        MemoryRegion const * const reg = proc->Vas.FindRegion(page);
+
+        res = likely(reg != nullptr)
+            ? CopyOnWrite(proc, page, reg->Flags)
+            : HandleResult::ArgumentOutOfRange;
+        //  The copy keeps the flags of the region, so read-only pages stay so.
+
+        proc->Vas.Lock.ReleaseAsReader();
+    }
 
     return res;
 }
@@ -238,26 +605,20 @@ Handle Vmm::CheckMemoryRegion(Execution::Process * proc
 
     vas->Lock.AcquireAsReader();
 
-    if (vas->LastSearched != nullptr && vas->LastSearched->Contains(addr))
-        reg = vas->LastSearched;
-        //  No need to check whether anything can be allocated in the page or not.
-    else
-    {
-    find_region:
-        reg = vas->FindRegion(addr);
+find_region:
+    reg = vas->FindRegion(addr);
 
-        if unlikely(reg == nullptr)
-            RETURN(ArgumentOutOfRange);
+    if unlikely(reg == nullptr)
+        RETURN(ArgumentOutOfRange);
 
-        if unlikely((0 != (type & MemoryCheckType::Free))
-                 && reg->Content == MemoryContent::Free)
-            goto next_region;
-        //  So free memory was asked for, and this is a free region. Let's move on.
+    if unlikely((0 != (type & MemoryCheckType::Free))
+             && reg->Content == MemoryContent::Free)
+        goto next_region;
+    //  So free memory was asked for, and this is a free region. Let's move on.
 
-        if unlikely((reg->Type & MemoryAllocationOptions::StrategyMask) == MemoryAllocationOptions::Reserve)
-            RETURN(PageReserved);
-        //  Regions which are reserved cannot be accessed like this.
-    }
+    if unlikely((reg->Type & MemoryAllocationOptions::StrategyMask) == MemoryAllocationOptions::Reserve)
+        RETURN(PageReserved);
+    //  Regions which are reserved cannot be accessed like this.
 
     if unlikely((0 != (reg->Type & MemoryAllocationOptions::GuardLow ) && DoRangesIntersect(chkrng, {reg->Range.Start         , PageSize}))
              || (0 != (reg->Type & MemoryAllocationOptions::GuardHigh) && DoRangesIntersect(chkrng, {reg->Range.End - PageSize, PageSize})))
@@ -299,7 +660,8 @@ Handle Vmm::AllocatePages(Process * proc, size_t const size
     , MemoryAllocationOptions const type
     , MemoryFlags const flags
     , MemoryContent content
-    , uintptr_t & vaddr)
+    , uintptr_t & vaddr
+    , size_t const alignment)
 {
     if (proc == nullptr) proc = likely(Cores::IsReady()) ? Cpu::GetProcess() : &BootstrapProcess;
 
@@ -310,9 +672,9 @@ Handle Vmm::AllocatePages(Process * proc, size_t const size
         //  AoD and reserved are both very simple to handle.
 
         if (0 != (type & MemoryAllocationOptions::VirtualUser))
-            return proc->Vas.Allocate(vaddr, size, flags, content, type);
+            return proc->Vas.Allocate(vaddr, size, flags, content, type, true, alignment);
         else
-            return KVas.Allocate(vaddr, size, flags, content, type);
+            return KVas.Allocate(vaddr, size, flags, content, type, true, alignment);
     }
     else if (0 != (type & MemoryAllocationOptions::Commit))
     {
@@ -322,13 +684,13 @@ Handle Vmm::AllocatePages(Process * proc, size_t const size
 
         if (0 != (type & MemoryAllocationOptions::VirtualUser))
         {
-            res = proc->Vas.Allocate(ret, size, flags, content, type);
+            res = proc->Vas.Allocate(ret, size, flags, content, type, true, alignment);
 
             heapLock = &(proc->LocalTablesLock);
         }
         else
         {
-            res = KVas.Allocate(ret, size, flags, content, type);
+            res = KVas.Allocate(ret, size, flags, content, type, true, alignment);
 
             heapLock = &(Vmm::KernelHeapLock);
         }
@@ -391,28 +753,29 @@ Handle Vmm::FreePages(Process * proc, uintptr_t const vaddr, size_t const size)
 
     if (vaddr >= KernelStart)
         vas = &(Vmm::KVas);
-    else
+    else if (vaddr >= UserlandEnd)
         return HandleResult::PageMapIllegalRange;
     //  Cannot use this to free memory from elsewhere.
 
-    return UnmapRange(proc, vaddr, size, MemoryMapOptions::None
-        , [](Process * proc_, uintptr_t vaddr_, void * cookie)
-        {
-            (void)proc_;
-            (void)vaddr_;
+    vas->LockRange(vaddr, vaddr + size);
+    //  Only releases of overlapping ranges wait for each other.
 
-            reinterpret_cast<Memory::Vas *>(cookie)->Lock.AcquireAsWriter();
-        }, [](Process * proc_, uintptr_t vaddr_, size_t size_, Handle oRes, void * cookie)
-        {
-            (void)proc_;
+    Handle res = vas->Free(vaddr, size);
 
-            Handle res = reinterpret_cast<Memory::Vas *>(cookie)->Free(vaddr_, size_, false, false, false);
-            reinterpret_cast<Memory::Vas *>(cookie)->Lock.ReleaseAsWriter();
+    if likely(res.IsOkayResult())
+    {
+        //  The regions are gone first, so faults cannot map anything new in
+        //  there; those already underway notice the change and undo their work.
 
-            if unlikely(oRes != HandleResult::Okay && oRes != HandleResult::PageUnmapped)
-                return oRes;
-            else
-                return res;
-        }
-        , vas);
+        Handle const uRes = UnmapRange(proc, vaddr, size);
+        //  This invalidates the whole range in one batch, which is flushed
+        //  before other frees of overlapping ranges may proceed.
+
+        if unlikely(uRes != HandleResult::Okay && uRes != HandleResult::PageUnmapped)
+            res = uRes;
+    }
+
+    vas->UnlockRange(vaddr, vaddr + size);
+
+    return res;
 }
@@ -38,21 +38,56 @@
 */
 
 #include <sys/time.h>
+#include <errno.h>
 #include "system/timers/pit.hpp"
+#include "system/timers/tsc.hpp"
 
 using namespace Beelzebub;
 using namespace Beelzebub::System;
 using namespace Beelzebub::System::Timers;
 
+static uint64_t GetMonotonicNanoseconds()
+{
+    if likely(Tsc::IsReliable())
+        return Tsc::GetNanoseconds();
+
+    return (uint64_t)Pit::Counter.Load() * 1000000;
+    //  Millisecond resolution, and only as good as the PIT's interrupts.
+}
+
+int clock_gettime(clockid_t clk, struct timespec * tp)
+{
+    switch (clk)
+    {
+    case CLOCK_REALTIME:
+    case CLOCK_MONOTONIC:
+        //  There is no wall clock yet, so both count from boot.
+        break;
+
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+
+    if likely(tp != nullptr)
+    {
+        uint64_t const ns = GetMonotonicNanoseconds();
+
+        *tp = {(time_t)(ns / 1000000000), (long)(ns % 1000000000)};
+    }
+
+    return 0;
+}
+
 int gettimeofday(struct timeval * tv, struct timezone * tz)
 {
     (void)tz;
 
     if likely(tv != nullptr)
     {
-        size_t const counter = Pit::Counter.Load();
+        uint64_t const us = GetMonotonicNanoseconds() / 1000;
 
-        *tv = {(time_t)(counter / 1000), (suseconds_t)((counter % 1000) * 1000)};
+        *tv = {(time_t)(us / 1000000), (suseconds_t)(us % 1000000)};
     }
 
     return 0;
@@ -69,8 +69,13 @@ Handle Syscalls::MemoryRequest(uintptr_t addr, size_t size, MemoryRequestOptions
     if (0 != (opts & MemoryRequestOptions::Commit))
         type |= MemoryAllocationOptions::Commit;
     else if (0 == (opts & MemoryRequestOptions::Reserve))
+    {
         type |= MemoryAllocationOptions::AllocateOnDemand;
 
+        if (0 != (opts & MemoryRequestOptions::FaultAround))
+            type |= MemoryAllocationOptions::FaultAround;
+    }
+
     if (0 != (opts & MemoryRequestOptions::ThreadStack))
         content = MemoryContent::ThreadStack;
 
@@ -79,6 +84,11 @@ Handle Syscalls::MemoryRequest(uintptr_t addr, size_t size, MemoryRequestOptions
     if (0 != (opts & MemoryRequestOptions::GuardHigh))
         type |= MemoryAllocationOptions::GuardHigh;
 
+    if (0 != (opts & MemoryRequestOptions::Align2MiB))
+        type |= MemoryAllocationOptions::Align2MiB;
+    if (0 != (opts & MemoryRequestOptions::Align1GiB))
+        type |= MemoryAllocationOptions::Align1GiB;
+
     MemoryFlags flags = MemoryFlags::Userland;
 
     if (0 != (opts & MemoryRequestOptions::Writable))
@@ -150,15 +160,23 @@ Handle Syscalls::MemoryCopy(uintptr_t const dst, uintptr_t const src, size_t con
 
     __try
     {
-        for (size_t chunk = 0; chunk < len; chunk += ChunkSize)
+        for (size_t chunk = 0; chunk < len && res.IsOkayResult(); chunk += ChunkSize)
         {
             size_t const curChunk = Minimum(ChunkSize, len - chunk);
 
             withInterrupts (false)
-            withWriteProtect (false)
-                memmove(reinterpret_cast<void *>(dst + chunk)
-                    , reinterpret_cast<void const *>(src + chunk)
-                    , curChunk);
+            {
+                res = Vmm::UnsharePages(nullptr, dst + chunk, curChunk);
+                //  With write protection off, the writes would land in whatever
+                //  frame backs the pages, even one shared with other pages or
+                //  processes.
+
+                if likely(res.IsOkayResult())
+                    withWriteProtect (false)
+                        memmove(reinterpret_cast<void *>(dst + chunk)
+                            , reinterpret_cast<void const *>(src + chunk)
+                            , curChunk);
+            }
         }
     }
     __catch ()
@@ -166,7 +184,7 @@ Handle Syscalls::MemoryCopy(uintptr_t const dst, uintptr_t const src, size_t con
         return HandleResult::Failed;
     }
 
-    return HandleResult::Okay;
+    return res;
 }
 
 Handle Syscalls::MemoryFill(uintptr_t const dst, uint8_t const val, size_t const len)
@@ -195,14 +213,20 @@ Handle Syscalls::MemoryFill(uintptr_t const dst, uint8_t const val, size_t const
 
     __try
     {
-        for (size_t chunk = 0; chunk < len; chunk += ChunkSize)
+        for (size_t chunk = 0; chunk < len && res.IsOkayResult(); chunk += ChunkSize)
         {
             size_t const curChunk = Minimum(ChunkSize, len - chunk);
 
             withInterrupts (false)
-            withWriteProtect (false)
-                memset(reinterpret_cast<void *>(dst + chunk), val, curChunk);
-            //  TODO: Exception handling, maybe?
+            {
+                res = Vmm::UnsharePages(nullptr, dst + chunk, curChunk);
+                //  Same as above.
+
+                if likely(res.IsOkayResult())
+                    withWriteProtect (false)
+                        memset(reinterpret_cast<void *>(dst + chunk), val, curChunk);
+                //  TODO: Exception handling, maybe?
+            }
         }
     }
     __catch ()
@@ -210,5 +234,5 @@ Handle Syscalls::MemoryFill(uintptr_t const dst, uint8_t const val, size_t const
         return HandleResult::Failed;
     }
 
-    return HandleResult::Okay;
+    return res;
 }
@@ -910,6 +910,37 @@ Handle TestObjectAllocator(bool const bsp)
         //     , "The allocator was asked to acquire a pool when it shouldn't have "
         //       "filled any pools yet!");
 
+        void * bulk[8];
+        size_t bulkCount = 0;
+
+        res = testAllocator.AllocateObjects(bulk, 8, bulkCount);
+
+        ASSERT(res.IsOkayResult() && bulkCount == 8
+            , "Failed to allocate objects in bulk: %H; %us allocated.%n"
+            , res, bulkCount);
+
+        for (size_t i = 0; i < 8; ++i)
+            for (size_t j = i + 1; j < 8; ++j)
+                ASSERT(bulk[i] != bulk[j]
+                    , "Bulk objects #%us and #%us should be different: %Xp.%n"
+                    , i, j, bulk[i]);
+
+        ASSERT(testAllocator.GetBusyCount() == 12
+            , "Test allocator should have 12 busy objects, not %us.%n"
+            , testAllocator.GetBusyCount());
+
+        res = testAllocator.DeallocateObjects(bulk, 8);
+
+        ASSERT(res.IsOkayResult()
+            , "Failed to deallocate objects in bulk: %H%n"
+            , res);
+
+        ASSERT(testAllocator.GetBusyCount() == 4
+                && testAllocator.GetCapacity() - testAllocator.GetFreeCount() == 4
+            , "Test allocator should have 4 busy objects after bulk deallocation, "
+              "not %us.%n"
+            , testAllocator.GetBusyCount());
+
         res = ObjectAllocatorSpamTest();
 
         if (!res.IsOkayResult())
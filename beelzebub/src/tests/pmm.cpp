@@ -178,7 +178,32 @@ void TestPmm(bool const bsp)
 
 #ifdef PRINT
     perfEnd = CpuInstructions::Rdtsc();
+#endif
+
+    {
+        paddr_t const freed = getPtr();
+        delPtr(freed);
+        paddr_t const recycled = getPtr();
+
+        ASSERTX(recycled == freed
+            , "Core %us did not get its last freed frame back from its magazine."
+            , coreIndex)(freed)(recycled)XEND;
 
+        delPtr(recycled);
+    }
+
+    {
+        paddr_t const run = Pmm::AllocateContiguous(16);
+
+        ASSERTX(run != nullpaddr && (run & 0xFFFF) == 0
+            , "Core %us got a misaligned contiguous run.", coreIndex)(run)XEND;
+
+        Handle res = Pmm::FreeContiguous(run, 16);
+
+        ASSERTX(res == HandleResult::Okay)(res)XEND;
+    }
+
+#ifdef PRINT
     MSG_("Core %us did %us Pmm::AllocateFrame & Pmm::AdjustReferenceCount pairs in %us cycles; %us cycles per pair.%n"
         , coreIndex, RandomIterations, perfEnd - perfStart, (perfEnd - perfStart + RandomIterations / 2) / RandomIterations);
 
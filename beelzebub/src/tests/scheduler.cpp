@@ -0,0 +1,205 @@
+/*
+    Copyright (c) 2017 Alexandru-Mihai Maftei. All rights reserved.
+
+
+    Developed by: Alexandru-Mihai Maftei
+    aka Vercas
+    http://vercas.com | https://github.com/vercas/Beelzebub
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal with the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+      * Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimers.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimers in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the names of Alexandru-Mihai Maftei, Vercas, nor the names of
+        its contributors may be used to endorse or promote products derived from
+        this Software without specific prior written permission.
+
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    WITH THE SOFTWARE.
+
+    ---
+
+    You may also find the text of this license in "LICENSE.md", along with a more
+    thorough explanation regarding other files.
+*/
+
+#ifdef __BEELZEBUB__TEST_SCHED
+
+#include "tests/scheduler.hpp"
+#include "execution/scheduler.hpp"
+#include "execution/extended_states.hpp"
+#include "system/cpu.hpp"
+#include "system/fpu.hpp"
+#include "cores.hpp"
+#include "kernel.hpp"
+
+#include <debug.hpp>
+
+using namespace Beelzebub;
+using namespace Beelzebub::Execution;
+using namespace Beelzebub::Synchronization;
+using namespace Beelzebub::System;
+using namespace Beelzebub::Terminals;
+
+Barrier SchedulerTestBarrier;
+
+#define SYNC SchedulerTestBarrier.Reach()
+
+static constexpr size_t const SwitchCount = 200000;
+
+static Atomic<uint64_t> DirectCycles {0}, DirectSlowest {0};
+static Atomic<uint64_t> QueuedCycles {0}, QueuedSlowest {0};
+
+static void Accumulate(Atomic<uint64_t> & total, Atomic<uint64_t> & slowest, uint64_t const cycles)
+{
+    total += cycles;
+
+    uint64_t old = slowest.Load();
+
+    while (cycles > old && !slowest.CmpXchgWeak(old, cycles)) { }
+}
+
+static void Report(char const * const name, Atomic<uint64_t> & total, Atomic<uint64_t> & slowest)
+{
+    size_t const cores = Cores::GetCount();
+
+    DEBUG_TERM_
+        << "Context switch (" << name << "): AVG "
+        << (total.Load() / (SwitchCount * cores)) << " cycles per core; "
+        << ((SwitchCount * cores * 1000000) / slowest.Load()) << " switches per Mcycle on "
+        << cores << " cores" << EndLine;
+}
+
+/*  Benchmarks  */
+
+static __startup uint64_t BenchmarkDirect(Thread * const a, Thread * const b)
+{
+    ThreadState scratch;
+
+    COMPILER_MEMORY_BARRIER();
+    uint64_t const start = CpuInstructions::Rdtsc();
+    COMPILER_MEMORY_BARRIER();
+
+    for (size_t i = 0; i < SwitchCount; i += 2)
+    {
+        a->SwitchTo(b, &scratch);
+        b->SwitchTo(a, &scratch);
+    }
+
+    COMPILER_MEMORY_BARRIER();
+    uint64_t const end = CpuInstructions::Rdtsc();
+    COMPILER_MEMORY_BARRIER();
+
+    return end - start;
+}
+
+static __startup uint64_t BenchmarkQueued(Thread * const a, Thread * const b)
+{
+    ThreadState scratch;
+    RunQueue rq {};
+    //  A private queue, so no real threads are picked up.
+
+    rq.Push(b);
+
+    Thread * current = a;
+
+    COMPILER_MEMORY_BARRIER();
+    uint64_t const start = CpuInstructions::Rdtsc();
+    COMPILER_MEMORY_BARRIER();
+
+    for (size_t i = 0; i < SwitchCount; ++i)
+    {
+        Thread * next;
+
+        withLock (rq.Lock)
+            next = rq.Pop();
+
+        current->SwitchTo(next, &scratch);
+
+        withLock (rq.Lock)
+            rq.Push(current);
+
+        current = next;
+    }
+
+    COMPILER_MEMORY_BARRIER();
+    uint64_t const end = CpuInstructions::Rdtsc();
+    COMPILER_MEMORY_BARRIER();
+
+    return end - start;
+}
+
+void TestScheduler(bool bsp)
+{
+    if (bsp)
+    {
+        Scheduling = false;
+        //  The dummy threads below must not be mistaken for real ones.
+
+        DirectCycles = DirectSlowest = QueuedCycles = QueuedSlowest = 0;
+    }
+
+    SYNC;
+
+    CpuData * const data = Cpu::GetData();
+
+    Thread a {&BootstrapProcess}, b {&BootstrapProcess};
+    //  Same process. Only the switch itself is measured.
+
+    a.KernelStackTop = b.KernelStackTop = data->EmbeddedTss.Rsp[0];
+    //  So the TSS and syscall stack remain valid afterwards.
+
+    if (Fpu::Eager)
+    {
+        Handle res = ExtendedStates::AllocateNew(a.ExtendedState);
+
+        if likely(res.IsOkayResult())
+            res = ExtendedStates::AllocateNew(b.ExtendedState);
+
+        ASSERT(res.IsOkayResult()
+            , "Failed to allocate extended states for scheduler test threads: %H."
+            , res);
+    }
+    //  Eager switches need them, like for any other thread.
+
+    withInterrupts (false)
+    {
+        Thread * const self = Cpu::GetThread();
+        Process * const selfProc = Cpu::GetProcess();
+
+        Accumulate(DirectCycles, DirectSlowest, BenchmarkDirect(&a, &b));
+        Accumulate(QueuedCycles, QueuedSlowest, BenchmarkQueued(&a, &b));
+
+        Cpu::SetThread(self);
+        Cpu::SetProcess(selfProc);
+    }
+
+    a.DisposeExtendedState();
+    b.DisposeExtendedState();
+
+    SYNC;
+
+    if (bsp)
+    {
+        Report("direct", DirectCycles, DirectSlowest);
+        Report("run queue", QueuedCycles, QueuedSlowest);
+
+        Scheduling = true;
+    }
+}
+
+#endif
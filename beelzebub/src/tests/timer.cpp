@@ -41,7 +41,7 @@
 
 #include <tests/timer.hpp>
 #include <timer.hpp>
-#include <synchronization/atomic.hpp>
+#include <beel/sync/atomic.hpp>
 #include <system/timers/apic.timer.hpp>
 #include <system/rtc.hpp>
 
@@ -66,6 +66,40 @@ static __startup void Test1(System::IsrState * const state, void * cookie)
     --Counter;
 }
 
+static constexpr size_t const BulkCount = 100;
+static Synchronization::Atomic<size_t> BulkCounter {0};
+
+static __startup void Test2(System::IsrState * const state, void * cookie)
+{
+    (void)state;
+
+    ASSERT(((size_t)cookie & 1) == 0
+        , "Cancelled timer %us fired!", (size_t)cookie);
+
+    ++BulkCounter;
+}
+
+static __startup void TestCancellation()
+{
+    TimerHandle handles[BulkCount];
+
+    for (size_t i = 0; i < BulkCount; ++i)
+        ASSERT(handles[i] = Timer::Enqueue(TimeSpanLite(1000 + i * 100), &Test2, reinterpret_cast<void *>(i))
+            , "Failed to enqueue timer %us.", i);
+    //  Far more than could fit in the old fixed-size queue.
+
+    for (size_t i = 1; i < BulkCount; i += 2)
+        ASSERT(Timer::Cancel(handles[i])
+            , "Failed to cancel timer %us.", i);
+
+    ASSERT(!Timer::Cancel(handles[1]), "Cancelled a timer twice!");
+
+    while (BulkCounter < BulkCount / 2) { }
+
+    for (size_t i = 0; i < BulkCount; i += 2)
+        ASSERT(!Timer::Cancel(handles[i]), "Cancelled a timer which fired!");
+}
+
 void TestTimer()
 {
     InterruptGuard<true> intGuard;
@@ -93,6 +127,8 @@ void TestTimer()
     ASSERT(InterruptState::IsEnabled());
 
     while (Counter > 0) { }
+
+    TestCancellation();
 }
 
 #endif
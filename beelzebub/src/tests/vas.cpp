@@ -43,7 +43,11 @@
 #include <memory/vmm.hpp>
 #include <execution/thread.hpp>
 #include <execution/thread_init.hpp>
+#include <execution/scheduler.hpp>
+#include <execution.hpp>
+#include <system/cpu.hpp>
 #include <beel/exceptions.hpp>
+#include <beel/syscalls.h>
 
 #include <kernel.hpp>
 
@@ -62,6 +66,7 @@ static Process testProcess;
 static volatile bool Barrier;
 
 static __startup void * TestThreadCode(void *);
+static __startup void TestCloneIsolation(uintptr_t const vaddr);
 
 __startup void TestDereferenceFailure(uintptr_t volatile * const testPtr)
 {
@@ -121,10 +126,13 @@ void TestVas()
 
     testThread.EntryPoint = &TestThreadCode;
 
-    InitializeThreadState(&testThread);
+    res = InitializeThreadState(&testThread);
 
-    withInterrupts (false)
-        BootstrapThread.IntroduceNext(&testThread);
+    ASSERT(res.IsOkayResult()
+        , "Failed to initialize VAS test thread: %H."
+        , res);
+
+    Scheduler::Enqueue(&testThread);
 
     while (Barrier) CpuInstructions::DoNothing();
 }
@@ -201,9 +209,80 @@ void * TestThreadCode(void *)
     && (vaddr + 6 * PageSize < vaddr2 || vaddr +     PageSize >= vaddr2))
         TestDereferenceFailure(reinterpret_cast<uintptr_t volatile *>(vaddr + 5 * PageSize));
 
+    vaddr = nullvaddr;
+
+    res = Vmm::AllocatePages(nullptr
+        , LargePageSize
+        , MemoryAllocationOptions::AllocateOnDemand | MemoryAllocationOptions::VirtualUser
+        | MemoryAllocationOptions::GuardLow | MemoryAllocationOptions::Align2MiB
+        , MemoryFlags::Userland | MemoryFlags::Writable
+        , MemoryContent::Generic
+        , vaddr);
+
+    ASSERT(res.IsOkayResult()
+        , "Failed to allocate aligned data for VAS test thread: %H."
+        , res);
+
+    ASSERT_EQ("%Xp", 0UL, vaddr % LargePageSize);
+
+    memset((void *)vaddr, 0x42, LargePageSize);
+
+    vsize_t largestFree = 0;
+
+    for (MemoryRegion const * reg = testProcess.Vas.First; reg != nullptr; reg = reg->Next)
+        if (reg->Content == MemoryContent::Free && reg->GetSize() > largestFree)
+            largestFree = reg->GetSize();
+
+    ASSERT_EQ("%Xp", largestFree, testProcess.Vas.Tree.Root->Payload.FreeGap);
+    //  The tree must track the largest free gap through all the operations.
+
+    TestCloneIsolation(vaddr1);
+
     Barrier = false;
 
     while (true) CpuInstructions::Halt();
 }
 
+void TestCloneIsolation(uintptr_t const vaddr)
+{
+    Process * child = nullptr;
+
+    Handle res = SpawnProcess(child);
+
+    ASSERT(res.IsOkayResult()
+        , "Failed to spawn a clone of the VAS test process: %H."
+        , res);
+
+    withInterrupts (false)
+    {
+        res = testProcess.SwitchTo(child);
+
+        ASSERT(res.IsOkayResult()
+            , "Failed to switch to the clone of the VAS test process: %H."
+            , res);
+
+        Cpu::SetProcess(child);
+
+        res = Syscalls::MemoryFill(vaddr, 0xEF, PageSize);
+        //  This writes regardless of write protection, like the clone would to
+        //  its own read-only pages.
+
+        ASSERT(res.IsOkayResult()
+            , "Failed to fill memory in the clone of the VAS test process: %H."
+            , res);
+
+        ASSERT_EQ("%X1", (uint8_t)0xEF, *reinterpret_cast<uint8_t volatile *>(vaddr + PageSize - 1));
+
+        Cpu::SetProcess(&testProcess);
+        child->SwitchTo(&testProcess);
+    }
+
+    for (size_t i = 0; i < PageSize; ++i)
+        ASSERT_EQ("%X1", (uint8_t)0xCD, reinterpret_cast<uint8_t volatile *>(vaddr)[i]);
+    //  The page was shared copy-on-write, and the parent must not see the
+    //  clone's writes.
+
+    DiscardProcess(child);
+}
+
 #endif
@@ -0,0 +1,156 @@
+/*
+    Copyright (c) 2017 Alexandru-Mihai Maftei. All rights reserved.
+
+
+    Developed by: Alexandru-Mihai Maftei
+    aka Vercas
+    http://vercas.com | https://github.com/vercas/Beelzebub
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal with the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+      * Redistributions of source code must retain the above copyright notice,
+        this list of conditions and the following disclaimers.
+      * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimers in the
+        documentation and/or other materials provided with the distribution.
+      * Neither the names of Alexandru-Mihai Maftei, Vercas, nor the names of
+        its contributors may be used to endorse or promote products derived from
+        this Software without specific prior written permission.
+
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    WITH THE SOFTWARE.
+
+    ---
+
+    You may also find the text of this license in "LICENSE.md", along with a more
+    thorough explanation regarding other files.
+*/
+
+#include <sys/time.h>
+#include <sched.h>
+#include <errno.h>
+#include <kernel_data.hpp>
+
+using namespace Beelzebub;
+using namespace Beelzebub::Execution;
+
+static __forceinline uint64_t ReadTsc()
+{
+    uint32_t low, high;
+
+    asm volatile ( "rdtsc \n\t" : "=a"(low), "=d"(high) );
+
+    return ((uint64_t)high << 32) | (uint64_t)low;
+}
+
+static bool GetMonotonicNanoseconds(uint64_t & ns)
+{
+    SharedData const * const sd = STARTUP_DATA.Shared;
+
+    if unlikely(sd == nullptr)
+        return false;
+
+    uint32_t seq;
+    uint64_t offset, mul;
+    uint32_t shift;
+    bool reliable;
+
+    do
+    {
+        seq = sd->Sequence;
+        COMPILER_MEMORY_BARRIER();
+
+        offset = sd->TscOffset;
+        mul = sd->TscMultiplier;
+        shift = sd->TscShift;
+        reliable = sd->TscReliable;
+
+        COMPILER_MEMORY_BARRIER();
+    } while ((seq & 1) != 0 || seq != sd->Sequence);
+    //  Odd means the kernel is in the middle of an update.
+
+    if unlikely(!reliable)
+        return false;
+
+    ns = (uint64_t)(((unsigned __int128)(ReadTsc() - offset) * mul) >> shift);
+
+    return true;
+}
+
+int clock_gettime(clockid_t clk, struct timespec * tp)
+{
+    switch (clk)
+    {
+    case CLOCK_REALTIME:
+    case CLOCK_MONOTONIC:
+        break;
+
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint64_t ns;
+
+    if unlikely(!GetMonotonicNanoseconds(ns))
+    {
+        errno = ENOSYS;
+        return -1;
+    }
+
+    if likely(tp != nullptr)
+        *tp = {(time_t)(ns / 1000000000), (long)(ns % 1000000000)};
+
+    return 0;
+}
+
+int gettimeofday(struct timeval * tv, struct timezone * tz)
+{
+    (void)tz;
+
+    uint64_t ns;
+
+    if unlikely(!GetMonotonicNanoseconds(ns))
+    {
+        errno = ENOSYS;
+        return -1;
+    }
+
+    if likely(tv != nullptr)
+    {
+        uint64_t const us = ns / 1000;
+
+        *tv = {(time_t)(us / 1000000), (suseconds_t)(us % 1000000)};
+    }
+
+    return 0;
+}
+
+int sched_getcpu(void)
+{
+    SharedData const * const sd = STARTUP_DATA.Shared;
+
+    if unlikely(sd == nullptr || !sd->CoreIndexInTscAux)
+    {
+        errno = ENOSYS;
+        return -1;
+    }
+
+    uint32_t low, high, aux;
+
+    asm volatile ( "rdtscp \n\t" : "=a"(low), "=d"(high), "=c"(aux) );
+    (void)low; (void)high;
+
+    return (int)aux;
+}
@@ -49,6 +49,9 @@
     ENUMINST(GuardHigh  , MEMREQ_GUARD_HIGH  , 0x020, "Guard High"  ) \
     ENUMINST(Reserve    , MEMREQ_RESERVE     , 0x100, "Reserve"     ) \
     ENUMINST(Commit     , MEMREQ_COMMIT      , 0x200, "Commit"      ) \
+    ENUMINST(FaultAround, MEMREQ_FAULT_AROUND, 0x400, "Fault Around") \
+    ENUMINST(Align2MiB  , MEMREQ_ALIGN_2MIB  , 0x800, "Align 2 MiB" ) \
+    ENUMINST(Align1GiB  , MEMREQ_ALIGN_1GIB  , 0x1000, "Align 1 GiB") \
     ENUMINST(ThreadStack, MEMREQ_THREAD_STACK, 0x031, "Thread Stack")
 
 #define ENUM_MEMRELOPTS(ENUMINST) \
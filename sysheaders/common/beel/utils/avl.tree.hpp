@@ -67,6 +67,18 @@ namespace Beelzebub { namespace Utils
         LevelOrder
     };
 
+    template<typename TPayload>
+    class AvlTreeNode;
+
+    //  Called whenever the subtree of a node may have changed, so payloads can
+    //  keep track of properties of their subtree. Overload it for a specific
+    //  node type to make use of this; it does nothing by default.
+    template<typename TPayload>
+    inline void AugmentNode(AvlTreeNode<TPayload> * const node)
+    {
+        (void)node;
+    }
+
     template<typename TPayload>
     class AvlTreeNode
     {
@@ -95,6 +107,8 @@ namespace Beelzebub { namespace Utils
 
         int ComputeHeight()
         {
+            AugmentNode(this);
+
             return this->Height = Maximum(GetHeight(this->Left), GetHeight(this->Right)) + 1;
         }
 
@@ -213,8 +227,12 @@ namespace Beelzebub { namespace Utils
             Handle res = Create(node, cookie);
 
             if likely(res.IsOkayResult())
+            {
                 node->Payload = payload;
 
+                AugmentNode(node);
+            }
+
             return res;
         }
 
@@ -506,6 +524,33 @@ namespace Beelzebub { namespace Utils
             return res;
         }
 
+        template<typename TKey>
+        static bool Refresh(TKey const & key, Node * const node)
+        {
+            if unlikely(node == nullptr)
+                return false;
+            //  Not found.
+
+            comp_t const compRes = Compare(node->Payload, key);
+            //  Note the comparison order.
+
+            bool res;
+
+            if (compRes > 0)
+                res = Refresh<TKey>(key, node->Left);
+            else if (compRes < 0)
+                res = Refresh<TKey>(key, node->Right);
+            else
+                res = true;
+
+            if likely(res)
+                node->ComputeHeight();
+            //  The height stays the same, but the augmentation is redone on
+            //  the way back up.
+
+            return res;
+        }
+
         template<typename TKey, typename TPredicate>
         static bool RemoveIf(TKey const & key, TPredicate pred, Node * & node, Node * & find)
         {
@@ -855,6 +900,19 @@ namespace Beelzebub { namespace Utils
             }
         }
 
+        //  Updates the nodes on the path to the given key after its payload
+        //  was changed in place, without affecting the order.
+        template<typename TKey>
+        Handle Refresh(TKey const key)
+        {
+            TKey dummy = key;
+
+            if unlikely(!Refresh<TKey>(dummy, this->Root))
+                return HandleResult::NotFound;
+
+            return HandleResult::Okay;
+        }
+
         /*  Iteration  */
 
         template<typename TLambda>
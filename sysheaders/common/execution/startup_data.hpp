@@ -40,6 +40,7 @@
 #pragma once
 
 #include <execution/elf.hpp>
+#include <execution/shared_data.hpp>
 
 #define STARTUP_DATA         __beel_rt_stadat
 #define STARTUP_DATA_SYMBOL "__beel_rt_stadat"
@@ -51,5 +52,6 @@ namespace Beelzebub { namespace Execution
         Elf RuntimeImage;
         uint64_t MemoryImageStart, MemoryImageEnd;
         Handle NonMemoryImage;
+        SharedData const * Shared;
     };
 }}
@@ -52,6 +52,14 @@ namespace Beelzebub { namespace Memory
         obj_ind_invalid = 0xFFFFFFFFU,
     };
 
+    /**
+     *  <summary>
+     *  Size of the naturally-aligned blocks which pool providers place pools
+     *  in, when they fit. Objects in such pools find their pool by masking.
+     *  </summary>
+     */
+    static constexpr size_t const ObjectPoolBlockSize = 0x10000;
+
     /**
      *  <summary>Represents the contents of a free object in the object pool.</summary>
      */
@@ -79,6 +87,10 @@ namespace Beelzebub { namespace Memory
         ObjectPoolBase * Next;
         //ObjectPoolBase * Previous;
 
+        void const * Owner;
+        //  The allocator this pool is linked into, so that an address which
+        //  merely masks to this pool's block can be told apart from its objects.
+
         /*  Constructors  */
 
         inline ObjectPoolBase()
@@ -87,6 +99,7 @@ namespace Beelzebub { namespace Memory
             , FirstFreeObject(obj_ind_invalid)
             , LastFreeObject(obj_ind_invalid)
             , Next(nullptr)
+            , Owner(nullptr)
         {
 
         }
@@ -127,6 +140,18 @@ namespace Beelzebub { namespace Memory
             return (obj_ind_t)((object - headerSize - ((uintptr_t)this)) / objectSize);
         }
 
+        /**
+         *  <summary>
+         *  Computes the index of an object with a multiplication by the
+         *  reciprocal of the object size, rounded up and scaled by 2^32.
+         *  It is exact for objects within an aligned pool block.
+         *  </summary>
+         */
+        inline obj_ind_t IndexOfScaled(const uintptr_t object, const uint64_t reciprocal, const size_t headerSize) const
+        {
+            return (obj_ind_t)(((object - headerSize - ((uintptr_t)this)) * reciprocal) >> 32);
+        }
+
         inline FreeObject * GetFirstFreeObject(const size_t objectSize, const size_t headerSize) const
         {
             return (FreeObject *)(uintptr_t)((uintptr_t)this + headerSize + this->FirstFreeObject * objectSize);
@@ -195,6 +195,7 @@ local availableTests = List {
     -- "VAS",
     --"INTERRUPT_LATENCY",
     "MALLOC",
+    "SCHED",
 }
 
 local settSelTests, settUnitTests = List { }, true